@@ -0,0 +1,94 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef _DISCORD_ESP32A_ARENA_H_
+#define _DISCORD_ESP32A_ARENA_H_
+
+namespace Discord {
+    /// @brief A stack allocator over one buffer allocated up front.
+    /// Blocks freed in reverse order of allocation are reclaimed immediately, anything else when reset() is called.
+    /// Not thread-safe, an arena belongs to the task that owns it.
+    class Arena {
+    public:
+        explicit Arena(size_t capacity);
+        ~Arena();
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        /// @return nullptr if the arena does not have size bytes left.
+        void* allocate(size_t size);
+        void deallocate(void* block);
+        void* reallocate(void* block, size_t size);
+
+        /// @brief Frees every block at once. Nothing allocated before may be used afterwards.
+        void reset();
+
+        size_t capacity() const { return _capacity; }
+        size_t used() const { return _top; }
+        /// @brief Most bytes in use at once since the arena was created, headers included.
+        size_t highWater() const { return _highWater; }
+        /// @brief Allocations refused for lack of space.
+        uint32_t failures() const { return _failures; }
+
+    private:
+        // Precedes every block, linking it to the block allocated before it.
+        struct Header {
+            uint32_t previous;
+            uint32_t size;
+        };
+
+        static size_t align(size_t size);
+        Header* headerOf(void* block) { return reinterpret_cast<Header*>(static_cast<uint8_t*>(block) - HEADER_SIZE); }
+
+        static const size_t ALIGNMENT = alignof(void*) > alignof(uint64_t) ? alignof(void*) : alignof(uint64_t);
+        static const size_t HEADER_SIZE = (sizeof(Header) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+        static const uint32_t NONE = UINT32_MAX;
+        // Size recorded for a block freed out of order.
+        static const uint32_t FREED = UINT32_MAX;
+
+        uint8_t* _buffer = nullptr;
+        size_t _capacity = 0;
+        size_t _top = 0;
+        // Offset of the most recent live block's header, or NONE.
+        uint32_t _last = NONE;
+        size_t _highWater = 0;
+        uint32_t _failures = 0;
+    };
+
+    // Plugs an Arena into ArduinoJson. Each document draws its whole memory pool from the arena in one
+    // allocation when constructed and returns it when destroyed.
+    struct ArenaAllocator {
+        explicit ArenaAllocator(Arena& arena) : arena { &arena } {}
+
+        void* allocate(size_t size) { return arena->allocate(size); }
+        void deallocate(void* block) { arena->deallocate(block); }
+        void* reallocate(void* block, size_t size) { return arena->reallocate(block, size); }
+
+        Arena* arena;
+    };
+
+    /// @brief A JSON document backed by an Arena. If the arena is exhausted the document has no capacity,
+    /// and deserialization reports NoMemory.
+    typedef BasicJsonDocument<ArenaAllocator> ArenaJsonDocument;
+}
+
+#endif //_DISCORD_ESP32A_ARENA_H_
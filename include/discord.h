@@ -16,13 +16,25 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <bitset>
 #include <mutex>
+#include <sys/time.h>
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <HTTPClient.h>
 #include <WebSocketsClient.h>
 
+#include <arena.h>
+#include <fixedstring.h>
+#include <log.h>
+#include <metrics.h>
+#include <requeststream.h>
+#include <responsestream.h>
+#include <signature.h>
+#include <stacksize.h>
+
 #ifndef _DISCORD_ESP32A_H_
 #define _DISCORD_ESP32A_H_
 
@@ -30,7 +42,133 @@
 #define DISCORD_API_URI "/api/v10"
 #define DISCORD_GATEWAY_SUFFIX "/?v=10&encoding=json"
 
+// Shortest wait for a heartbeat ACK before the connection is considered zombied, in ms.
+// The actual timeout scales with the measured heartbeat RTT, up to the heartbeat interval.
+#define DISCORD_HEARTBEAT_ACK_TIMEOUT 5000
+// WebSocket-level ping interval and pong timeout in ms, and how many missed pongs close the connection.
+#define DISCORD_WS_PING_INTERVAL 15000
+#define DISCORD_WS_PONG_TIMEOUT 3000
+#define DISCORD_WS_PONG_MISSES 2
+// How long a connection attempt may take to reach READY or RESUMED, in ms.
+#define DISCORD_CONNECT_TIMEOUT 15000
+// Reconnection backoff bounds in ms. The delay doubles per failed attempt and resets once connected.
+#define DISCORD_RECONNECT_BACKOFF_MIN 1000
+#define DISCORD_RECONNECT_BACKOFF_MAX 60000
+// Failed connection attempts to the resume URL before the session is dropped and the bot identifies again.
+#define DISCORD_RESUME_ATTEMPTS 3
+// Capacity of the document a gateway frame or an interaction POSTed to the endpoint is parsed into.
+// Slots are twice as large on 64-bit hosts, so native builds raise this and the arena below.
+#ifndef DISCORD_FRAME_DOCUMENT_SIZE
+#define DISCORD_FRAME_DOCUMENT_SIZE 2048
+#endif
+// Bytes set aside for every JSON document the bot builds or parses on the gateway loop.
+// A frame document, with room on top for the documents built while handling it.
+#ifndef DISCORD_JSON_ARENA_SIZE
+#define DISCORD_JSON_ARENA_SIZE 4096
+#endif
+// Stack given to each async POST task, on top of room for its response document, until the task has been
+// seen running and can be sized from what it used. See stacksize.h.
+#define DISCORD_POST_TASK_STACK (4 * 1024)
+// Interaction responses allowed to be sending at once, and heap to leave free after admitting one.
+// Anything over budget is answered with a short ephemeral busy message instead.
+#ifndef DISCORD_RESPONSES_IN_FLIGHT_MAX
+#define DISCORD_RESPONSES_IN_FLIGHT_MAX 3
+#endif
+#ifndef DISCORD_RESPONSE_HEAP_RESERVE
+#define DISCORD_RESPONSE_HEAP_RESERVE (16 * 1024)
+#endif
+#define DISCORD_BUSY_MESSAGE "Busy, please try again in a moment."
+// Most suggestions Discord accepts in one autocomplete result.
+#define DISCORD_AUTOCOMPLETE_CHOICES_MAX 25
+// Shards in the same identify bucket, their id modulo max_concurrency, may only identify once per interval in ms.
+#define DISCORD_IDENTIFY_INTERVAL 5000
+// Identify buckets tracked, enough for max_concurrency of any bot that is not very large.
+#define DISCORD_IDENTIFY_BUCKETS 16
+
 namespace Discord {
+    // Protocol strings, sized to what Discord sends. Capacities exclude the terminator.
+    // Session ids are 32 characters, gateway hosts are short discord.gg subdomains.
+    typedef FixedString<64> SessionId;
+    typedef FixedString<64> GatewayHost;
+    // Interaction tokens are opaque and around 200 characters long.
+    typedef FixedString<256> InteractionToken;
+    // API paths and full URLs, long enough for an interaction callback path carrying a full token.
+    typedef FixedString<352> RestPath;
+    // "Bot " followed by the bot token.
+    typedef FixedString<96> AuthorisationHeader;
+
+    // Gateway intent bits. An event is only sent by Discord if one of the intents that covers it is identified with.
+    namespace Intents {
+        constexpr uint32_t GUILDS = 1 << 0;
+        // Privileged, must also be enabled on the developer portal.
+        constexpr uint32_t GUILD_MEMBERS = 1 << 1;
+        constexpr uint32_t GUILD_MODERATION = 1 << 2;
+        constexpr uint32_t GUILD_EMOJIS_AND_STICKERS = 1 << 3;
+        constexpr uint32_t GUILD_INTEGRATIONS = 1 << 4;
+        constexpr uint32_t GUILD_WEBHOOKS = 1 << 5;
+        constexpr uint32_t GUILD_INVITES = 1 << 6;
+        constexpr uint32_t GUILD_VOICE_STATES = 1 << 7;
+        // Privileged, must also be enabled on the developer portal.
+        constexpr uint32_t GUILD_PRESENCES = 1 << 8;
+        constexpr uint32_t GUILD_MESSAGES = 1 << 9;
+        constexpr uint32_t GUILD_MESSAGE_REACTIONS = 1 << 10;
+        constexpr uint32_t GUILD_MESSAGE_TYPING = 1 << 11;
+        constexpr uint32_t DIRECT_MESSAGES = 1 << 12;
+        constexpr uint32_t DIRECT_MESSAGE_REACTIONS = 1 << 13;
+        constexpr uint32_t DIRECT_MESSAGE_TYPING = 1 << 14;
+        // Privileged, must also be enabled on the developer portal. Delivers no events of its own, it fills in
+        // message contents outside of DMs and mentions.
+        constexpr uint32_t MESSAGE_CONTENT = 1 << 15;
+        constexpr uint32_t GUILD_SCHEDULED_EVENTS = 1 << 16;
+        constexpr uint32_t AUTO_MODERATION_CONFIGURATION = 1 << 20;
+        constexpr uint32_t AUTO_MODERATION_EXECUTION = 1 << 21;
+
+        constexpr uint32_t PRIVILEGED = GUILD_MEMBERS | GUILD_PRESENCES | MESSAGE_CONTENT;
+    }
+
+    /// @brief Free heap in bytes, or UINT32_MAX on platforms that cannot report it.
+    inline uint32_t freeHeap() {
+#ifdef ESP32
+        return esp_get_free_heap_size();
+#else
+        return UINT32_MAX;
+#endif
+    }
+
+    // Snowflakes count milliseconds from the first second of 2015.
+    constexpr uint64_t DISCORD_EPOCH = 1420070400000ULL;
+
+    /// @brief When a snowflake id was created, in ms since the Unix epoch.
+    constexpr uint64_t snowflakeTimestamp(uint64_t id) {
+        return (id >> 22) + DISCORD_EPOCH;
+    }
+
+    /// @brief Wall clock time in ms since the Unix epoch, or 0 until it has been set, e.g. by SNTP.
+    inline uint64_t wallClock() {
+        struct timeval now;
+        gettimeofday(&now, nullptr);
+        uint64_t ms = static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_usec / 1000;
+        return ms >= DISCORD_EPOCH ? ms : 0;
+    }
+
+    /// @brief Ends the calling asynchronous request. On ESP32 this deletes the FreeRTOS task and does not return.
+    inline void endTask() {
+#ifdef ESP32
+        vTaskDelete(nullptr);
+#endif
+    }
+
+    // Records what a POST task used of its stack, just before it ends.
+    // The room for the response document is left out of both sides, so the usage recorded holds for any size.
+    // Only a task that opened its connection went through a TLS handshake, the deepest path it has.
+    inline void recordPostTaskStack(uint32_t allocated, bool opened) {
+#ifdef ESP32
+        UBaseType_t unused = uxTaskGetStackHighWaterMark(NULL);
+        Metrics::registry.postTaskStackHighWater.setMin(unused);
+        Stack::record(Stack::Task::Post, allocated, unused, opened);
+#endif
+    }
+
     class Bot {
     public:
         enum class Event {
@@ -117,6 +255,32 @@ namespace Discord {
             VoiceServerUpdate,
             WebhooksUpdate
         };
+        static constexpr size_t EVENT_COUNT = static_cast<size_t>(Event::WebhooksUpdate) + 1;
+
+        struct EventDescriptor {
+            Event event;
+            // Dispatch name, or nullptr for gateway opcodes.
+            const char* name;
+            // Intents that each deliver the event. 0 means it is always delivered.
+            uint32_t intents;
+        };
+
+        /// @brief Looks up the dispatch name and intents of an event.
+        static const EventDescriptor& describe(Event event);
+
+        enum class ConnectionState {
+            // Not connected, waiting for the next attempt or logged out.
+            Disconnected,
+            // Fetching a gateway URL from the REST API.
+            FetchingGateway,
+            // Waiting for the WebSocket connection and Hello.
+            Connecting,
+            // Identify sent, waiting for READY.
+            Identifying,
+            // Resume sent, waiting for RESUMED.
+            Resuming,
+            Ready
+        };
 
         enum class InteractionResponse {
             // ACK a Ping
@@ -135,85 +299,87 @@ namespace Discord {
             MODAL
         };
 
-        // struct User {
-        //     enum class PremiumType {
-        //         NONE,
-        //         NITRO_CLASSIC,
-        //         NITRO,
-        //         NITRO_BASIC
-        //     };
-
-        //     uint64_t id = 0;
-        //     const char* username = "";
-        //     uint16_t discriminator = 0;
-        //     const char* globalName = "";
-        //     const char* avatarHash = "";
-        //     bool bot = false;
-        //     bool system = false;
-        //     bool mfaEnabled = false;
-        //     const char* bannerHash = "";
-        //     int accentColor = 0;
-        //     const char* locale = "";
-        //     bool verified = false;
-        //     const char* email = "";
-        //     uint32_t flags = 0;
-        //     PremiumType premiumType = PremiumType::NONE;
-        //     uint32_t publicFlags = 0;
-        //     const char* avatarDecoHash = "";
-        // };
-
-        // struct Member {
-        //     const char* nick = "";
-        //     const char* avatarHash = "";
-        //     std::vector<uint64_t> roles;
-        //     //TODO: joined_at, premium_since
-        //     bool deaf = false;
-        //     bool mute = false;
-        //     uint32_t flags = 0;
-        //     bool pending = false;
-        //     uint64_t permissions = 0;
-        //     //TODO: communication_disabled_until?
-        // };
-
-        // struct Interaction {
-        //     enum class Type {
-        //         INVALID,
-        //         PING = 1,
-        //         APPLICATION_COMMAND,
-        //         MESSAGE_COMPONENT,
-        //         APPLICATION_COMMAND_AUTOCOMPLETE,
-        //         MODAL_SUBMIT
-        //     };
-
-        //     struct Data {
-        //         uint64_t commandId = 0;
-        //         const char* name = "";
-        //         CommandType type = CommandType::INVALID;
-        //         // TODO: resolved?, options?
-        //         uint64_t guildId = 0;
-        //         uint64_t targetId = 0;
-        //     };
-
-        //     uint64_t id = 0;
-        //     uint64_t applicationId = 0;
-        //     Type type = Type::INVALID;
-        //     Data data;
-        //     uint64_t guildId = 0;
-        //     // TODO: channel?
-        //     uint64_t channelId = 0;
-        //     Member member;
-        //     User user;
-        //     uint8_t version = 1;
-        //     // TODO: message?
-        //     uint64_t permissions = 0;
-        //     const char* locale = "";
-        //     // Not available for PING interactions
-        //     const char* guildLocale = "";
-        // };
-
-        typedef std::function<void(Event type, const StaticJsonDocument<1024>& json)> EventCallback;
-        typedef std::function<void(const char* name, const JsonObject& interaction)> InteractionCallback;
-        //typedef std::function<void(const char* name, const Interaction& interaction)> InteractionCallback;
+        // Interactions are read once as they are received. Strings point into the receive buffer and, like the rest
+        // of the view, are only valid for the duration of the callback. Missing strings are empty rather than null.
+        struct User {
+            uint64_t id = 0;
+            const char* username = "";
+            const char* globalName = "";
+            bool bot = false;
+        };
+
+        struct Member {
+            const char* nick = "";
+            // Permissions of the member in the channel, including overwrites.
+            uint64_t permissions = 0;
+            bool pending = false;
+        };
+
+        struct Interaction {
+            enum class Type {
+                INVALID,
+                PING = 1,
+                APPLICATION_COMMAND,
+                MESSAGE_COMPONENT,
+                APPLICATION_COMMAND_AUTOCOMPLETE,
+                MODAL_SUBMIT
+            };
+
+            struct Data {
+                uint64_t commandId = 0;
+                const char* name = "";
+                // One of Interactions::CommandType.
+                uint8_t type = 0;
+                uint64_t guildId = 0;
+                uint64_t targetId = 0;
+                JsonArrayConst options;
+            };
+
+            uint64_t id = 0;
+            uint64_t applicationId = 0;
+            Type type = Type::INVALID;
+            Data data;
+            uint64_t guildId = 0;
+            uint64_t channelId = 0;
+            // Only filled in for interactions from a guild.
+            Member member;
+            // The invoking user, whether the interaction came from a guild or a DM.
+            User user;
+            uint8_t version = 1;
+            // Permissions of the bot in the channel.
+            uint64_t appPermissions = 0;
+            const char* locale = "";
+            // Not available for PING interactions
+            const char* guildLocale = "";
+            // The interaction as received, for anything not read above.
+            JsonObjectConst json;
+
+            bool inGuild() const { return guildId != 0; }
+
+            /// @brief The value given for a top-level option, null if it was left out.
+            JsonVariantConst option(const char* name) const;
+        };
+
+        /// @brief A read-only view of a gateway payload, straight over the parsed frame. Like the frame, it is only
+        /// valid for the duration of the callback.
+        struct EventView {
+            // The specific event for dispatches that have one, otherwise Dispatch or the opcode's event.
+            Event event;
+            int op;
+            // Dispatch sequence number, 0 for other opcodes.
+            unsigned int sequence;
+            // Dispatch event name, nullptr for other opcodes.
+            const char* name;
+            JsonVariantConst d;
+        };
+
+        // Called once per event.
+        typedef std::function<void(const EventView& event)> EventCallback;
+        typedef std::function<void(const char* name, const Interaction& interaction)> InteractionCallback;
+        // Called on every keystroke in an autocomplete option, with the option being typed and its value so far.
+        // Answer with sendAutocompleteResult().
+        typedef std::function<void(const char* command, const char* option, const char* value,
+            const Interaction& interaction)> AutocompleteCallback;
 
         struct MessageResponse {
             enum class Flags : char {
@@ -233,7 +399,27 @@ namespace Discord {
 
         Bot(const char* botToken, bool rateLimit = true);
 
-        void login(unsigned int intents = 0);
+        /// @brief Starts connecting to the gateway. The connection is then kept up by update(), reconnecting
+        /// with backoff as needed, until logout() is called.
+        /// Identifies with the smallest set of intents that delivers every subscribed event.
+        /// Interactions need no intents.
+        void login();
+        /// @brief As login(), but identifies with exactly these intents, warning about subscribed events
+        /// none of them deliver.
+        void login(uint32_t intents);
+
+        /// @brief Makes this bot one shard of the application, identifying with its shard id. Every shard needs a Bot
+        /// of its own, each with its own session. Must be called before login().
+        /// @param count Total shards, or 0 to use the count Discord recommends when first connecting.
+        void setShard(uint16_t id, uint16_t count = 0);
+
+        /// @brief The shard a guild's events are delivered to.
+        static uint16_t shardFor(uint64_t guildId, uint16_t count) { return (guildId >> 22) % count; }
+
+        /// @brief Declares that the application handles an event, so login() asks for the intents it needs.
+        /// @param intents Narrows the intents requested for it, e.g. only DIRECT_MESSAGES for MessageCreate.
+        /// 0 requests every intent that delivers it.
+        void subscribe(Event event, uint32_t intents = 0);
 
         void update(unsigned long now);
 
@@ -242,31 +428,125 @@ namespace Discord {
         void onEvent(const EventCallback& cb);
         void onInteraction(const InteractionCallback& cb);
 
-        void sendCommandResponse(const InteractionResponse& type, const StaticJsonDocument<512>& response);
+        /// @brief Binds handlers at compile time, as an alternative to onEvent() and onInteraction() that neither
+        /// allocates nor limits the bot to one handler. Each handler is a type with any of
+        /// static void onEvent(const EventView&) and static void onInteraction(const char* name, const Interaction&),
+        /// called in the order listed, after the std::function callbacks. Calls into the list are inlined, so
+        /// dispatch costs one call through a function pointer however many handlers there are.
+        /// Binding again replaces the previous list.
+        template <typename... Handlers>
+        void bind();
+
+        /// @brief Sets the application's public key, from the developer portal, used to verify interactions
+        /// received with receiveInteraction().
+        /// @param publicKey 64 hex digits.
+        bool setPublicKey(const char* publicKey);
+
+        /// @brief Handles an interaction POSTed to an interactions endpoint, as an alternative to receiving it over
+        /// the gateway. Callbacks run as they do for the gateway, but their response is written to reply instead of
+        /// being sent as a separate callback request. Call from the same task as update().
+        /// @param signature The X-Signature-Ed25519 header.
+        /// @param timestamp The X-Signature-Timestamp header.
+        /// @param body Parsed in place once verified, like gateway frames, so it is modified.
+        /// @param reply Set to the JSON body to answer with.
+        /// @return The HTTP status to answer with, 401 if the signature does not verify.
+        int receiveInteraction(const char* signature, const char* timestamp, char* body, size_t length,
+            String& reply);
+        void onAutocomplete(const AutocompleteCallback& cb);
+
+        void sendCommandResponse(const InteractionResponse& type, const JsonDocument& response);
         void sendCommandResponse(const InteractionResponse& type, const MessageResponse& response);
 
+        /// @brief Answers the current autocomplete interaction. Each suggestion is both shown and sent as the value.
+        /// @param count Number of suggestions, anything past DISCORD_AUTOCOMPLETE_CHOICES_MAX is left out.
+        void sendAutocompleteResult(const char* const* suggestions, size_t count);
+
         //void updatePresence();
 
         bool online() { return _online; }
 
+        /// @brief Whether login() has been called without a logout() since.
+        bool active() { return _active; }
+
+        ConnectionState state() { return _state; }
+
+        /// @brief Smoothed gateway heartbeat round trip time in ms, or 0 before the first ACK.
+        unsigned long heartbeatRtt() { return _heartbeatRtt; }
+
+        /// @brief When the interaction being handled arrived, by millis(), for timing what a handler does.
+        unsigned long interactionReceived() { return _interactionReceived; }
+
         uint64_t applicationId() { return _applicationId; }
+
+        uint16_t shardId() { return _shardId; }
+        /// @brief Total shards, 0 if the bot is not sharded or the recommended count is not known yet.
+        uint16_t shardCount() { return _shardCount; }
+
+        /// @brief The arena backing the bot's JSON documents. Documents built from it inside callbacks
+        /// must be destroyed before the callback returns.
+        Arena& jsonArena() { return _arena; }
+
+        /// @brief Runs request with the bot's REST client, locked against the response tasks. Requests made
+        /// through it reuse the kept-alive connection instead of opening one, and a handshake, of their own.
+        /// Without login(), e.g. when interactions come from an endpoint, the connection is closed afterwards.
+        void withRestClient(const std::function<void(HTTPClient& client)>& request);
     private:
         void onWebSocketEvents(WStype_t type, uint8_t* payload, size_t length);
         void parseMessage(uint8_t* payload, size_t length);
 
+        void connect();
+        // Closes the gateway connection. With the session kept, the next connect() resumes it.
+        void dropConnection(bool keepSession);
+        // Drops the connection and reconnects after a fixed delay, without backoff.
+        void reconnectNow(bool keepSession, unsigned long delay = 0);
+        // Schedules the next connection attempt after a failure, with jittered exponential backoff.
+        void scheduleReconnect();
+        void setState(ConnectionState state);
+
         void heartbeat();
+        unsigned long heartbeatAckTimeout();
+        // Keeps the REST connection open between responses, once per heartbeat ACK.
+        void keepRestAlive();
+        // Sends Identify once the shard's identify bucket is free, and leaves it pending until then.
         void identify();
         void resume();
+        // Whether a response of this size fits the in-flight and heap budget.
+        bool admitResponse(size_t length);
+        // Answers the current interaction in place on _busyHttps with a fixed ephemeral message, or no suggestions for
+        // autocomplete, without spawning a task.
+        void sendBusyResponse(const InteractionResponse& type, const char* url);
+
+        void restoreSession();
+        void checkpointSession();
+        void checkpointSequence();
+        void clearSessionCheckpoint();
 
         bool sendWS(const char* payload, size_t length);
+        // Runs the callbacks for an interaction, from the gateway or an endpoint.
+        void handleInteraction(JsonObjectConst json);
+        // Hands a payload to the event callback, if one is set.
+        void deliver(Event event, const JsonDocument& doc);
+
+        // Backs every JSON document on the gateway loop, and is reset for each frame received.
+        Arena _arena { DISCORD_JSON_ARENA_SIZE };
 
+        // Held by anything using _https, which is shared by the gateway loop and the response tasks.
         std::mutex _httpsMtx;
         HTTPClient _https;
+        // Only used by the gateway loop, for busy replies, which would otherwise wait behind the response tasks
+        // holding _https. Its connection is opened by the first busy reply and kept for the next.
+        HTTPClient _busyHttps;
         WebSocketsClient _socket;
         EventCallback _outerCallback;
         InteractionCallback _interactionCallback;
+        // Entry points of the handler list given to bind(), if any.
+        void (*_eventHandlers)(const EventView& event) = nullptr;
+        void (*_interactionHandlers)(const char* name, const Interaction& interaction) = nullptr;
+        AutocompleteCallback _autocompleteCallback;
 
-        String _gatewayURL;
+        GatewayHost _gatewayURL;
+        // Set on READY and kept across disconnects, so a dropped session can be resumed where Discord expects it.
+        GatewayHost _resumeGatewayURL;
 
         const char* _op = "op";
         const char* _d = "d";
@@ -274,20 +554,54 @@ namespace Discord {
         const char* _botToken = nullptr;
         uint64_t _applicationId = 0;
         unsigned int _intents = 0;
+        std::bitset<EVENT_COUNT> _subscribed;
+        // Union of the intents requested by subscribe().
+        uint32_t _subscribedIntents = 0;
 
         uint64_t _interactionId;
-        String _interactionToken;
+        InteractionToken _interactionToken;
+        // Set while handling an interaction received over HTTP, which is answered in the reply.
+        String* _inlineReply = nullptr;
+        uint8_t _publicKey[Signature::PUBLIC_KEY_SIZE];
+        bool _publicKeySet = false;
+        // When the frame being parsed arrived, by millis() and by the wall clock.
+        unsigned long _frameReceived = 0;
+        uint64_t _frameReceivedWall = 0;
+        unsigned long _interactionReceived = 0;
+        // Responses admitted whose POST task has not finished yet.
+        std::atomic<unsigned int> _responsesInFlight { 0 };
 
         bool _online = false;
+        bool _active = false;
 
-        unsigned long _now;
+        ConnectionState _state = ConnectionState::Disconnected;
+        unsigned long _stateSince = 0;
+        unsigned long _nextAttempt = 0;
+        unsigned long _backoff = 0;
+        unsigned int _connectFailures = 0;
+
+        unsigned long _now = 0;
         unsigned long _heartbeatInterval = 0;
         unsigned long _lastHeartbeatAck = 0;
         unsigned long _lastHeartbeatSend = 0;
         unsigned long _firstHeartbeat = 0;
+        // Heartbeats sent since the last ACK. Discord ACKs every heartbeat, so more than one means a dead connection.
+        unsigned int _heartbeatsOutstanding = 0;
+        unsigned long _heartbeatSentAt = 0;
+        // Exponentially weighted moving average of heartbeat RTT, weighted 1/8 per sample.
+        unsigned long _heartbeatRtt = 0;
+        // Set by a heartbeat ACK, so the REST keep-alive goes out after it rather than between a heartbeat and its ACK.
+        bool _restKeepAliveDue = false;
+
+        bool _sharded = false;
+        uint16_t _shardId = 0;
+        uint16_t _shardCount = 0;
+        // Sessions Discord lets start at once, from GET /gateway/bot. Each is an identify bucket.
+        uint16_t _maxConcurrency = 1;
+        bool _identifyPending = false;
 
         bool _ready = false;
-        String _sessionId;
+        SessionId _sessionId;
         // You need to cache the most recent non-null sequence value for heartbeats, and to pass when resuming a connection.
         unsigned int _lastSocketSequence = 0;
 
@@ -306,46 +620,83 @@ namespace Discord {
         AsyncAPIRequest(
             HTTPClient& httpClient,
             const char* method,
-            const String& uri,
-            const String& json = "",
+            const char* uri,
+            const JsonDocument* body = nullptr,
             const char* authorisationToken = "",
             std::function<void(const StaticJsonDocument<sz>& json)> cb = nullptr,
-            std::mutex* mtx = nullptr);
+            std::mutex* mtx = nullptr,
+            std::atomic<unsigned int>* inFlight = nullptr);
+        ~AsyncAPIRequest();
+
+        AsyncAPIRequest(const AsyncAPIRequest&) = delete;
+        AsyncAPIRequest& operator=(const AsyncAPIRequest&) = delete;
 
         HTTPClient& client;
         const char* method;
-        const String uri = "";
-        const String json = "";
+        const RestPath uri;
+        // The body serialized into one allocation of exactly its length, since the document it came from
+        // does not outlive the caller. nullptr if there is no body, or it could not be allocated.
+        char* body = nullptr;
+        size_t length = 0;
         const char* authorisationToken = "";
         std::function<void(const StaticJsonDocument<sz>& json)> callback;
         std::mutex* clientMtx = nullptr;
+        // Counts the request while it exists, if given.
+        std::atomic<unsigned int>* inFlight = nullptr;
+        // Stack the sending task was created with, less the room for its response document.
+        uint32_t stack = 0;
     };
 
     bool sendRest(
         HTTPClient& client,
         const char* method,
-        const String& uri,
+        const char* uri,
         const String& json = "",
         const char* authorisationToken = "");
 
+    /// @brief Sends a request and deserializes the response body into responseDoc, if given.
+    /// The body is read straight off the connection, so the client should collect ResponseStream::HEADERS.
+    /// @param filter Only the fields set in this document are kept, if given.
+    bool sendRest(
+        HTTPClient& client,
+        const char* method,
+        const char* uri,
+        const String& json,
+        const char* authorisationToken,
+        JsonDocument* responseDoc,
+        const JsonDocument* filter = nullptr);
+
+    /// @brief As above, with the body serialized from a document straight onto the connection in blocks,
+    /// instead of into a String first.
+    bool sendRest(
+        HTTPClient& client,
+        const char* method,
+        const char* uri,
+        const JsonDocument& body,
+        const char* authorisationToken,
+        JsonDocument* responseDoc = nullptr,
+        const JsonDocument* filter = nullptr);
+
     template <size_t sz>
     bool sendRest(
         HTTPClient& client,
         const char* method,
-        const String& uri,
+        const char* uri,
         const String& json = "",
         const char* authorisationToken = "",
         StaticJsonDocument<sz>* responseDoc = nullptr);
 
+    /// @return false if the task or the body's buffer could not be allocated, in which case the request is dropped.
     template <size_t sz>
-    void sendPostAsync(
+    bool sendPostAsync(
         HTTPClient& httpClient,
         const char* method,
-        const String& uri,
-        const String& json,
+        const char* uri,
+        const JsonDocument& body,
         const char* authorisationToken,
         std::function<void(const StaticJsonDocument<sz>& json)> cb,
-        std::mutex* mtx);
+        std::mutex* mtx,
+        std::atomic<unsigned int>* inFlight = nullptr);
 
     template <size_t sz>
     void sendPostTask(void* parameter);
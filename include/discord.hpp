@@ -22,136 +22,129 @@
 #endif
 
 namespace Discord {
-    template<size_t sz>
-    inline bool sendRest(
-        HTTPClient& client,
-        const char* method,
-        const String& uri,
-        const String& json,
-        const char* authorisationToken,
-        StaticJsonDocument<sz>* responseDoc) {
-
-        client.setURL(uri);
-
-        if (strcmp(method, "GET") != 0) {
-            client.addHeader("Content-Type", "application/json");
-            if (strlen(authorisationToken) > 0) {
-                String headerTok = "Bot ";
-                headerTok += authorisationToken;
-                client.addHeader("Authorization", headerTok);
-            }
+    /// @brief Handlers bound at compile time by Bot::bind(). Each handler's static members are called directly,
+    /// and a handler without one of them is skipped when compiling.
+    template <typename... Handlers>
+    struct HandlerList {
+        static void onEvent(const Bot::EventView& event) {
+            int expand[] = { 0, (callEvent<Handlers>(0, event), 0)... };
+            (void)expand;
         }
 
-        int httpResponseCode = 0;
-        if (!json.isEmpty()) {
-            httpResponseCode = client.sendRequest(method, json);
-
-        }
-        else {
-            httpResponseCode = client.sendRequest(method);
+        static void onInteraction(const char* name, const Bot::Interaction& interaction) {
+            int expand[] = { 0, (callInteraction<Handlers>(0, name, interaction), 0)... };
+            (void)expand;
         }
-#ifdef _DISCORD_CLIENT_DEBUG
-#ifdef ESP32
-        log_d("[DISCORD] Sent %s request to %s", method, uri.c_str());
-#else
-        Serial.print(method);
-        Serial.print(" request to ");
-        Serial.println(uri);
-#endif
-#endif
 
-        if (httpResponseCode > 0) {
-#ifdef _DISCORD_CLIENT_DEBUG
-#ifdef ESP32
-            log_d("[DISCORD] HTTP Response code: %d", httpResponseCode);
-#else
-            Serial.print("[DISCORD] HTTP Response code: ");
-            Serial.println(httpResponseCode);
-#endif
-#endif
-            if (httpResponseCode != 204) { //204 no content
-                if (responseDoc)
-                {
-                    // Here we pass getString instead of getStream. While ArduinoJson recommends against this,
-                    // this allows us to keep the benefits of HTTP 1.1+, since Discord's payloads are usually small.
-#ifdef _DISCORD_CLIENT_DEBUG
-                    String p = client.getString();
-                    DeserializationError e = deserializeJson(*responseDoc, p);
-                    Serial.println(p);
-#else
-                    DeserializationError e = deserializeJson(*responseDoc, client.getString());
-#endif
-                    if (e) {
-                        Serial.print(F("deserializeJson() failed with code "));
-                        Serial.println(e.f_str());
+    private:
+        // The int overload is preferred, and only exists when the handler has the member.
+        template <typename H>
+        static auto callEvent(int, const Bot::EventView& event) -> decltype(H::onEvent(event), void()) {
+            H::onEvent(event);
+        }
+        template <typename H>
+        static void callEvent(long, const Bot::EventView&) {}
 
-                        // Serialisation failed, free resources
-                        //client.end();
-                        return false;
-                    }
-                }
-                else {
-                    Serial.println(client.getString());
-                }
-            }
-            if (httpResponseCode == 401) {
-                Serial.println("[DISCORD] 401 Not Authorised.");
-                return false;
-            }
-            return true;
+        template <typename H>
+        static auto callInteraction(int, const char* name, const Bot::Interaction& interaction)
+            -> decltype(H::onInteraction(name, interaction), void()) {
+            H::onInteraction(name, interaction);
         }
+        template <typename H>
+        static void callInteraction(long, const char*, const Bot::Interaction&) {}
+    };
+
+    template <typename... Handlers>
+    void Bot::bind() {
+        _eventHandlers = &HandlerList<Handlers...>::onEvent;
+        _interactionHandlers = &HandlerList<Handlers...>::onInteraction;
+    }
 
-        // Request failed
-        Serial.print("[DISCORD] Error code: ");
-        Serial.println(httpResponseCode);
-        return false;
+    template<size_t sz>
+    inline bool sendRest(
+        HTTPClient& client,
+        const char* method,
+        const char* uri,
+        const String& json,
+        const char* authorisationToken,
+        StaticJsonDocument<sz>* responseDoc) {
+        return sendRest(client, method, uri, json, authorisationToken, static_cast<JsonDocument*>(responseDoc));
     }
 
     template<size_t sz>
     AsyncAPIRequest<sz>::AsyncAPIRequest(
         HTTPClient& httpClient,
         const char* method,
-        const String& uri,
-        const String& json,
+        const char* uri,
+        const JsonDocument* body,
         const char* authorisationToken,
         std::function<void(const StaticJsonDocument<sz>& json)> cb,
-        std::mutex* mtx) :
+        std::mutex* mtx,
+        std::atomic<unsigned int>* inFlight) :
         client { httpClient },
         method { method },
         uri { uri },
-        json { json },
         authorisationToken { authorisationToken },
         callback { cb },
-        clientMtx { mtx } {}
+        clientMtx { mtx },
+        inFlight { inFlight } {
+        if (body) {
+            size_t measured = measureJson(*body);
+            this->body = static_cast<char*>(malloc(measured + 1));
+            if (this->body) {
+                length = serializeJson(*body, this->body, measured + 1);
+            }
+        }
+        if (inFlight) {
+            inFlight->fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    template<size_t sz>
+    AsyncAPIRequest<sz>::~AsyncAPIRequest() {
+        free(body);
+        if (inFlight) {
+            inFlight->fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
 
     template<size_t sz>
-    void sendPostAsync(
+    bool sendPostAsync(
         HTTPClient& httpClient,
         const char* method,
-        const String& uri,
-        const String& json,
+        const char* uri,
+        const JsonDocument& body,
         const char* authorisationToken,
         std::function<void(const StaticJsonDocument<sz>& json)> cb,
-        std::mutex* mtx) {
+        std::mutex* mtx,
+        std::atomic<unsigned int>* inFlight) {
 
         AsyncAPIRequest<sz>* request = new AsyncAPIRequest<sz>(
-            httpClient, method, uri, json, authorisationToken, std::move(cb), mtx);
+            httpClient, method, uri, &body, authorisationToken, std::move(cb), mtx, inFlight);
+        if (request->body == nullptr) {
+            DISCORD_LOGE("[DISCORD] Not enough memory for the request body.");
+            delete request;
+            return false;
+        }
 
+        request->stack = Stack::size(Stack::Task::Post, DISCORD_POST_TASK_STACK);
         TaskHandle_t task = nullptr;
         // Task priority of 2 will ensure the post request gets sent first within the 3s window.
         // IIRC, this also avoids the scheduler from switching back and forth, avoiding race conditions.
-        xTaskCreate(
+        if (xTaskCreate(
             sendPostTask<sz>,
             "DiscordSendPostTask",
-            4 * 1024 + sz,
+            request->stack + sz,
             static_cast<void*>(request),
-            tskIDLE_PRIORITY + 2, &task);
+            tskIDLE_PRIORITY + 2, &task) != pdPASS) {
+            DISCORD_LOGE("[DISCORD] Not enough memory to create an async task.");
+            delete request;
+            return false;
+        }
 
-#ifdef _DISCORD_CLIENT_DEBUG
-        Serial.print("Async task created with ");
-        Serial.print(4 * 1024 + sz);
-        Serial.println(" bytes of stack allocated.");
-#endif
+        DISCORD_LOGD("[DISCORD] Async task created with %u bytes of stack allocated.",
+            static_cast<unsigned>(request->stack + sz));
+        return true;
     }
 
     template<size_t sz>
@@ -165,89 +158,84 @@ namespace Discord {
             request->clientMtx->lock();
         }
 
-        request->client.setURL(request->uri);
+        request->client.setURL(request->uri.c_str());
+        bool reused = request->client.connected();
+        Metrics::registry.recordRestConnection(reused);
 
         int httpResponseCode = 0;
 
         request->client.addHeader("Content-Type", "application/json");
         if (strlen(request->authorisationToken) > 0) {
-            String headerTok = "Bot ";
+            AuthorisationHeader headerTok("Bot ");
             headerTok += request->authorisationToken;
-            request->client.addHeader("Authorization", headerTok);
+            request->client.addHeader("Authorization", headerTok.c_str());
         }
 
 #ifdef _DISCORD_CLIENT_DEBUG
-        if (!request->json.isEmpty()) {
+        if (request->length > 0) {
 #endif
-            httpResponseCode = request->client.POST(request->json);
+            httpResponseCode = request->client.sendRequest(
+                request->method, reinterpret_cast<uint8_t*>(request->body), request->length);
+            Metrics::registry.recordRestStatus(httpResponseCode);
 #ifdef _DISCORD_CLIENT_DEBUG
         }
         else {
             // Request failed
-            Serial.print("[DISCORD] No payload to POST with!");
+            DISCORD_LOGE("[DISCORD] No payload to POST with!");
+            if (request->clientMtx) {
+                request->clientMtx->unlock();
+            }
+            recordPostTaskStack(request->stack, !reused);
             delete request;
-            vTaskDelete(nullptr);
+            endTask();
+            return;
         }
-#ifdef ESP32
-        log_d("[DISCORD] Sent %s request to %s", request->method, request->uri.c_str());
-#else
-        Serial.print(request->method);
-        Serial.print(" request to ");
-        Serial.println(request->uri);
 #endif
-        long currentStack = uxTaskGetStackHighWaterMark(NULL);
-        Serial.print("[STACK CHECK] sendPostTask() - Free Stack Space: ");
-        Serial.println(currentStack);
-#endif
-        if (httpResponseCode > 0) {
-#ifdef _DISCORD_CLIENT_DEBUG
+        DISCORD_LOGD("[DISCORD] Sent %s request to %s", request->method, request->uri.c_str());
 #ifdef ESP32
-            log_d("[DISCORD] HTTP Response code: %d", httpResponseCode);
-#else
-            Serial.print("[DISCORD] HTTP Response code: ");
-            Serial.println(httpResponseCode);
-#endif
+        DISCORD_LOGD("[STACK CHECK] sendPostTask() - Free Stack Space: %u", uxTaskGetStackHighWaterMark(NULL));
 #endif
+        if (httpResponseCode > 0) {
+            DISCORD_LOGD("[DISCORD] HTTP Response code: %d", httpResponseCode);
+            ResponseStream body(request->client);
             if (httpResponseCode == HTTP_CODE_BAD_REQUEST) {
-                Serial.println("[DISCORD] 400 Bad Request.");
+                DISCORD_LOGE("[DISCORD] 400 Bad Request.");
             }
             else if (httpResponseCode == HTTP_CODE_UNAUTHORIZED) {
-                Serial.println("[DISCORD] 401 Not Authorised.");
+                DISCORD_LOGE("[DISCORD] 401 Not Authorised.");
             }
             else if (request->callback != nullptr) {
                 StaticJsonDocument<sz> response;
 
-                // Here we pass getString instead of getStream. While ArduinoJson recommends against this,
-                // this allows us to keep the benefits of HTTP 1.1+, since Discord's payloads are usually small.
+                // Parsed straight off the connection, which is left ready for the next request.
                 if (httpResponseCode != HTTP_CODE_NO_CONTENT) {
-#ifdef _DISCORD_CLIENT_DEBUG
-                    String p = request->client.getString();
-                    DeserializationError e = deserializeJson(response, p);
-                    Serial.println(p);
-#else
-                    DeserializationError e = deserializeJson(response, request->client.getString());
-#endif
+                    DeserializationError e = deserializeJson(response, body);
                     if (e) {
-                        Serial.print(F("deserializeJson() failed with code "));
-                        Serial.println(e.c_str());
+                        DISCORD_LOGE("[DISCORD] deserializeJson() failed with code %s", e.c_str());
                     }
                 }
                 request->callback(response);
             }
+            if (httpResponseCode != HTTP_CODE_NO_CONTENT) {
+                body.drain();
+                DISCORD_LOGD("[DISCORD] Response body: %u bytes", static_cast<unsigned>(body.consumed()));
+            }
             if (request->clientMtx) {
                 request->clientMtx->unlock();
             }
+            recordPostTaskStack(request->stack, !reused);
             delete request;
-            vTaskDelete(nullptr);
+            endTask();
+            return;
         }
 
         // Request failed
         if (request->clientMtx) {
             request->clientMtx->unlock();
         }
-        Serial.print("[DISCORD] Error code: ");
-        Serial.println(httpResponseCode);
+        DISCORD_LOGE("[DISCORD] Error code: %d", httpResponseCode);
+        recordPostTaskStack(request->stack, !reused);
         delete request;
-        vTaskDelete(nullptr);
+        endTask();
     }
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+
+#include <log.h>
+
+#ifndef _DISCORD_ESP32A_FIXEDSTRING_H_
+#define _DISCORD_ESP32A_FIXEDSTRING_H_
+
+namespace Discord {
+    /// @brief A string stored inline with a fixed capacity, for protocol values that are reassigned often
+    /// and would otherwise fragment the heap over long uptimes.
+    /// @tparam N The longest string held, excluding the terminator.
+    template <size_t N>
+    class FixedString {
+    public:
+        static constexpr size_t CAPACITY = N;
+
+        FixedString() { _data[0] = '\0'; }
+        FixedString(const char* str) : FixedString() { assign(str); }
+
+        /// @brief Replaces the contents. A string that does not fit is logged, since what it was for cannot work.
+        /// @return false if str did not fit, in which case the string is left empty.
+        bool assign(const char* str) { return assign(str, str ? strlen(str) : 0); }
+        bool assign(const char* str, size_t length) {
+            if (length > N) {
+                DISCORD_LOGE("[DISCORD] %u characters do not fit in a string of %u, it is left empty.",
+                    static_cast<unsigned>(length), static_cast<unsigned>(N));
+                clear();
+                return false;
+            }
+            memcpy(_data, str, length);
+            _data[length] = '\0';
+            _length = length;
+            return true;
+        }
+
+        /// @brief Appends to the contents. A result that does not fit is logged.
+        /// @return false if the result would not fit, in which case the string is unchanged.
+        bool append(const char* str) {
+            size_t length = strlen(str);
+            if (_length + length > N) {
+                DISCORD_LOGE("[DISCORD] Appending %u characters to a string of %u/%u would overflow it, it is unchanged.",
+                    static_cast<unsigned>(length), static_cast<unsigned>(_length), static_cast<unsigned>(N));
+                return false;
+            }
+            memcpy(_data + _length, str, length + 1);
+            _length += length;
+            return true;
+        }
+        bool append(uint64_t value) {
+            char digits[21];
+            size_t i = sizeof(digits) - 1;
+            digits[i] = '\0';
+            do {
+                digits[--i] = '0' + value % 10;
+                value /= 10;
+            } while (value > 0);
+            return append(digits + i);
+        }
+
+        FixedString& operator=(const char* str) {
+            assign(str);
+            return *this;
+        }
+        FixedString& operator+=(const char* str) {
+            append(str);
+            return *this;
+        }
+        FixedString& operator+=(uint64_t value) {
+            append(value);
+            return *this;
+        }
+
+        bool operator==(const char* str) const { return str && strcmp(_data, str) == 0; }
+        bool operator!=(const char* str) const { return !(*this == str); }
+
+        const char* c_str() const { return _data; }
+        size_t length() const { return _length; }
+        bool isEmpty() const { return _length == 0; }
+        void clear() {
+            _data[0] = '\0';
+            _length = 0;
+        }
+
+    private:
+        char _data[N + 1];
+        size_t _length = 0;
+    };
+}
+
+#endif //_DISCORD_ESP32A_FIXEDSTRING_H_
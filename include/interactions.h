@@ -67,6 +67,9 @@ namespace Discord::Interactions {
             bool required;
             Choice* choices;
             size_t choicesLength = 0;
+            // Suggest values as the user types, answered through Bot::onAutocomplete().
+            // Only for STRING, INTEGER and NUMBER options, and not together with choices.
+            bool autocomplete = false;
         };
 
         const char* name;
@@ -100,6 +103,23 @@ namespace Discord::Interactions {
     bool deleteGuildCommand(
         uint64_t applicationId, const char* guildId, const String& commandId, const char* botToken);
 
+    /// @brief Looks up the bot's application ID with its token, for when it is not known from READY,
+    /// e.g. when interactions arrive on an endpoint and the gateway is never connected.
+    /// @return The application ID, or 0 if it could not be fetched.
+    uint64_t getApplicationId(const char* botToken);
+
+    // The overloads below send on a client already begun on DISCORD_HOST, such as the one handed out by
+    // Bot::withRestClient(), and leave its connection open. The ones above open and close a connection of
+    // their own, paying for a full TLS handshake each call.
+    uint64_t registerGlobalCommand(
+        HTTPClient& client, uint64_t applicationId, const ApplicationCommand& command, const char* botToken);
+    uint64_t registerGuildCommand(HTTPClient& client,
+        uint64_t applicationId, const char* guildId, const ApplicationCommand& command, const char* botToken);
+    bool deleteGlobalCommand(HTTPClient& client, uint64_t applicationId, const String& commandId, const char* botToken);
+    bool deleteGuildCommand(HTTPClient& client,
+        uint64_t applicationId, const char* guildId, const String& commandId, const char* botToken);
+    uint64_t getApplicationId(HTTPClient& client, const char* botToken);
+
     bool serializeCommand(const ApplicationCommand& command, StaticJsonDocument<1024>& doc);
 }
 
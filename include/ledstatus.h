@@ -0,0 +1,98 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <mutex>
+
+#include <Arduino.h>
+
+#ifndef _DISCORD_ESP32A_LEDSTATUS_H_
+#define _DISCORD_ESP32A_LEDSTATUS_H_
+
+// Animation cycle lengths and how often the timer steps them, in ms.
+#ifndef LED_BLINK_PERIOD
+#define LED_BLINK_PERIOD 500
+#endif
+#ifndef LED_FADE_PERIOD
+#define LED_FADE_PERIOD 2000
+#endif
+#ifndef LED_TICK
+#define LED_TICK 20
+#endif
+
+/// @brief Drives a single status LED from layered state requests. Each layer holds one request, and the highest
+/// layer with a request is shown. The LED is only written when the colour shown changes, and animations are
+/// stepped from a timer instead of the caller's loop.
+class LedStatus {
+public:
+    // In increasing priority.
+    enum class Layer {
+        // Wi-Fi and gateway state, always set.
+        Connection,
+        // Work in progress, e.g. a command being handled.
+        Activity,
+        // Feedback while the button is held.
+        Button,
+        // Something failed.
+        Error,
+        COUNT
+    };
+
+    enum class Mode {
+        Solid,
+        // On and off, LED_BLINK_PERIOD ms per cycle.
+        Blink,
+        // Up and down in brightness, LED_FADE_PERIOD ms per cycle.
+        Fade
+    };
+
+    typedef void (*Writer)(uint32_t colour);
+
+    /// @param writer Shows a 0xRRGGBB colour on the LED. Called from the timer task once begin() is called.
+    explicit LedStatus(Writer writer) : _writer { writer } {}
+
+    /// @brief Starts the timer that writes the LED and steps animations. Until then, update() must be called.
+    bool begin();
+
+    /// @brief Requests a colour on a layer, replacing what the layer held.
+    /// @param duration How long the request lasts in ms, or 0 to last until cleared.
+    void set(Layer layer, uint32_t colour, Mode mode = Mode::Solid, unsigned long duration = 0);
+    void clear(Layer layer);
+
+    /// @brief Writes the LED if the colour shown has changed since it was last written.
+    void update();
+
+private:
+    struct Request {
+        uint32_t colour = 0;
+        Mode mode = Mode::Solid;
+        unsigned long since = 0;
+        unsigned long duration = 0;
+        bool active = false;
+    };
+
+    // The colour the top request shows at a point in time.
+    static uint32_t render(const Request& request, unsigned long now);
+
+    Writer _writer;
+    std::mutex _mtx;
+    Request _layers[static_cast<size_t>(Layer::COUNT)];
+    uint32_t _written = 0;
+    bool _dirty = true;
+};
+
+#endif //_DISCORD_ESP32A_LEDSTATUS_H_
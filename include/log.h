@@ -0,0 +1,104 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+
+#ifndef _DISCORD_ESP32A_LOG_H_
+#define _DISCORD_ESP32A_LOG_H_
+
+#define DISCORD_LOG_LEVEL_NONE 0
+#define DISCORD_LOG_LEVEL_ERROR 1
+#define DISCORD_LOG_LEVEL_WARN 2
+#define DISCORD_LOG_LEVEL_INFO 3
+#define DISCORD_LOG_LEVEL_DEBUG 4
+#define DISCORD_LOG_LEVEL_VERBOSE 5
+
+// Messages above this level are compiled out entirely, arguments included.
+#ifndef DISCORD_LOG_LEVEL
+#ifdef _DISCORD_CLIENT_DEBUG
+#define DISCORD_LOG_LEVEL DISCORD_LOG_LEVEL_VERBOSE
+#else
+#define DISCORD_LOG_LEVEL DISCORD_LOG_LEVEL_INFO
+#endif
+#endif
+
+// Number of buffered lines, must be a power of two. Lines are dropped, and counted, while the buffer is full.
+#ifndef DISCORD_LOG_SLOTS
+#define DISCORD_LOG_SLOTS 32
+#endif
+// Longest line kept, including the terminator. Longer lines are truncated.
+#ifndef DISCORD_LOG_LINE_LENGTH
+#define DISCORD_LOG_LINE_LENGTH 128
+#endif
+
+#if DISCORD_LOG_LEVEL >= DISCORD_LOG_LEVEL_ERROR
+#define DISCORD_LOGE(...) Discord::Log::write(Discord::Log::Level::Error, __VA_ARGS__)
+#else
+#define DISCORD_LOGE(...) do {} while (0)
+#endif
+#if DISCORD_LOG_LEVEL >= DISCORD_LOG_LEVEL_WARN
+#define DISCORD_LOGW(...) Discord::Log::write(Discord::Log::Level::Warn, __VA_ARGS__)
+#else
+#define DISCORD_LOGW(...) do {} while (0)
+#endif
+#if DISCORD_LOG_LEVEL >= DISCORD_LOG_LEVEL_INFO
+#define DISCORD_LOGI(...) Discord::Log::write(Discord::Log::Level::Info, __VA_ARGS__)
+#else
+#define DISCORD_LOGI(...) do {} while (0)
+#endif
+#if DISCORD_LOG_LEVEL >= DISCORD_LOG_LEVEL_DEBUG
+#define DISCORD_LOGD(...) Discord::Log::write(Discord::Log::Level::Debug, __VA_ARGS__)
+#else
+#define DISCORD_LOGD(...) do {} while (0)
+#endif
+#if DISCORD_LOG_LEVEL >= DISCORD_LOG_LEVEL_VERBOSE
+#define DISCORD_LOGV(...) Discord::Log::write(Discord::Log::Level::Verbose, __VA_ARGS__)
+#else
+#define DISCORD_LOGV(...) do {} while (0)
+#endif
+
+// Deferred logging: callers format a line into a lock-free ring buffer and return, and a low-priority task
+// writes the buffer out to the sink, so the gateway loop never waits on the UART.
+namespace Discord::Log {
+    enum class Level : uint8_t {
+        None,
+        Error,
+        Warn,
+        Info,
+        Debug,
+        Verbose
+    };
+
+    /// @brief Starts draining buffered lines to a sink. Lines logged before this are kept until then.
+    /// @param sink Where lines are written, usually Serial.
+    /// @param priority Priority of the drain task, keep it below anything latency-sensitive.
+    void begin(Print& sink = Serial, unsigned int priority = 1);
+
+    /// @brief Formats a line into the buffer. Safe from any task, never blocks.
+    void write(Level level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    /// @brief Writes out every buffered line from the calling task.
+    /// Used by the drain task, or directly on platforms without one.
+    /// @return The number of lines written.
+    size_t flush();
+
+    /// @brief Lines dropped because the buffer was full.
+    uint32_t dropped();
+}
+
+#endif //_DISCORD_ESP32A_LOG_H_
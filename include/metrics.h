@@ -0,0 +1,129 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+
+#include <Arduino.h>
+
+#ifndef _DISCORD_ESP32A_METRICS_H_
+#define _DISCORD_ESP32A_METRICS_H_
+
+// Metrics are plain 32-bit atomics, so they can be updated from the gateway loop and the async POST tasks
+// without locking, and read at any time by /stats or the Prometheus endpoint.
+namespace Discord::Metrics {
+    class Counter {
+    public:
+        void increment(uint32_t n = 1) { _value.fetch_add(n, std::memory_order_relaxed); }
+        uint32_t value() const { return _value.load(std::memory_order_relaxed); }
+    private:
+        std::atomic<uint32_t> _value { 0 };
+    };
+
+    class Gauge {
+    public:
+        void set(uint32_t value) { _value.store(value, std::memory_order_relaxed); }
+        // Keeps the lowest value reported so far, e.g. for stack high-water marks. 0 means nothing reported yet.
+        void setMin(uint32_t value);
+        uint32_t value() const { return _value.load(std::memory_order_relaxed); }
+    private:
+        std::atomic<uint32_t> _value { 0 };
+    };
+
+    // Fixed-bucket histogram of millisecond durations.
+    class Histogram {
+    public:
+        static constexpr size_t BUCKETS = 12;
+        // Inclusive upper bounds of each bucket in ms, the last bucket catches everything above.
+        static constexpr uint32_t BOUNDS[BUCKETS - 1] = { 5, 10, 25, 50, 100, 250, 500, 1000, 2000, 3000, 5000 };
+
+        void observe(uint32_t ms);
+
+        uint32_t count() const { return _count.load(std::memory_order_relaxed); }
+        uint32_t sum() const { return _sum.load(std::memory_order_relaxed); }
+        uint32_t maxObserved() const { return _max.load(std::memory_order_relaxed); }
+        uint32_t bucket(size_t i) const { return _buckets[i].load(std::memory_order_relaxed); }
+
+        /// @brief Estimates a quantile from the buckets.
+        /// @param q The quantile, between 0 and 1.
+        /// @return The upper bound of the bucket the quantile falls in, capped at maxObserved().
+        uint32_t percentile(float q) const;
+    private:
+        std::atomic<uint32_t> _buckets[BUCKETS] = {};
+        std::atomic<uint32_t> _count { 0 };
+        std::atomic<uint32_t> _sum { 0 };
+        std::atomic<uint32_t> _max { 0 };
+    };
+
+    struct Registry {
+        // Dispatch events tracked individually, everything else is counted as OTHER.
+        enum Dispatch { READY, RESUMED, INTERACTION_CREATE, MESSAGE_CREATE, OTHER, DISPATCH_COUNT };
+        // Index 0 counts requests that failed before a status code was received, 1-5 count 1xx to 5xx.
+        static constexpr size_t REST_CLASSES = 6;
+        static constexpr size_t OPCODES = 12;
+
+        // INTERACTION_CREATE received to the callback POST completing.
+        Histogram interactionLatency;
+        // Spans of each interaction, in order. Transit is only recorded once the wall clock is set.
+        // Interaction created, by its snowflake, to its frame being received.
+        Histogram interactionTransit;
+        // Frame received to the interaction being parsed.
+        Histogram interactionParse;
+        // Parsed to the handler returning, including anything it waits on.
+        Histogram interactionHandler;
+        // Response handed to the POST task to Discord acknowledging it, including any TLS handshake.
+        Histogram interactionPost;
+        // Interaction received to the wake packet it asked for being sent, recorded by the application.
+        Histogram interactionWake;
+        // Gateway heartbeat sent to its ACK received.
+        Histogram heartbeatRtt;
+
+        Counter restResponses[REST_CLASSES];
+        Counter restRateLimited;
+        // REST requests sent on a kept-alive connection, and ones that had to connect and handshake first.
+        Counter restConnectionsReused;
+        Counter restConnectionsOpened;
+        Counter gatewayConnects;
+        Counter gatewayDisconnects;
+        Counter heartbeatTimeouts;
+        // Interaction responses answered with the busy message instead, for lack of memory or concurrency.
+        Counter responsesShed;
+        Counter opcodes[OPCODES];
+        Counter dispatches[DISPATCH_COUNT];
+
+        Gauge loopStackHighWater;
+        Gauge postTaskStackHighWater;
+        // Most of the bot's JSON arena in use at once, and allocations it refused.
+        Gauge jsonArenaHighWater;
+        Gauge jsonArenaFailures;
+
+        void recordRestStatus(int code);
+        void recordRestConnection(bool reused);
+        void recordOpcode(int op);
+        void recordDispatch(const char* name);
+    };
+
+    extern Registry registry;
+
+    /// @brief Writes every metric in the Prometheus text exposition format.
+    void writePrometheus(Print& out);
+
+    /// @brief Writes a short human-readable summary, small enough for a Discord message.
+    void writeSummary(Print& out);
+}
+
+#endif //_DISCORD_ESP32A_METRICS_H_
@@ -0,0 +1,79 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+
+#ifndef _DISCORD_ESP32A_PREFIXINDEX_H_
+#define _DISCORD_ESP32A_PREFIXINDEX_H_
+
+namespace Discord {
+    /// @brief A case-insensitive prefix index over a fixed vocabulary, for answering autocomplete.
+    /// Words are kept sorted as they are added, so a lookup is a binary search followed by a scan over the
+    /// matches, and never allocates. The index only stores pointers, the words must outlive it.
+    /// @tparam N The most words held.
+    template <size_t N>
+    class PrefixIndex {
+    public:
+        /// @brief Adds a word, keeping the index sorted.
+        /// @return false if the index is full.
+        bool add(const char* word) {
+            if (_count >= N) return false;
+            size_t i = _count;
+            while (i > 0 && strcasecmp(_words[i - 1], word) > 0) {
+                _words[i] = _words[i - 1];
+                --i;
+            }
+            _words[i] = word;
+            ++_count;
+            return true;
+        }
+
+        /// @brief Finds the words starting with prefix, in alphabetical order.
+        /// @param matches Filled with up to max words.
+        /// @return The number of words written to matches.
+        size_t find(const char* prefix, const char** matches, size_t max) const {
+            size_t length = strlen(prefix);
+
+            // Matches are contiguous, starting from the first word not ordered before the prefix.
+            size_t low = 0, high = _count;
+            while (low < high) {
+                size_t mid = low + (high - low) / 2;
+                if (strcasecmp(_words[mid], prefix) < 0) {
+                    low = mid + 1;
+                }
+                else {
+                    high = mid;
+                }
+            }
+
+            size_t found = 0;
+            for (size_t i = low; i < _count && found < max && strncasecmp(_words[i], prefix, length) == 0; ++i) {
+                matches[found++] = _words[i];
+            }
+            return found;
+        }
+
+        size_t size() const { return _count; }
+
+    private:
+        const char* _words[N];
+        size_t _count = 0;
+    };
+}
+
+#endif //_DISCORD_ESP32A_PREFIXINDEX_H_
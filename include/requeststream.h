@@ -0,0 +1,56 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#ifndef _DISCORD_ESP32A_REQUESTSTREAM_H_
+#define _DISCORD_ESP32A_REQUESTSTREAM_H_
+
+namespace Discord {
+    /// @brief Reads a JSON document as a request body, serializing each read straight into the caller's buffer.
+    /// The body is never held whole in memory, so it can be sent with HTTPClient::sendRequest(method, &stream, size()).
+    /// The document must outlive the stream.
+    class RequestStream : public Stream {
+    public:
+        explicit RequestStream(const JsonDocument& body) : _body { body }, _length { measureJson(body) } {}
+
+        /// @brief Length of the whole body, for Content-Length.
+        size_t size() const { return _length; }
+
+        int available() override { return _length - _offset; }
+        // Each call serializes the document again, read in blocks with readBytes() where possible.
+        int read() override;
+        int peek() override;
+        size_t readBytes(char* buffer, size_t length) override;
+
+        // Request bodies are read-only.
+        size_t write(uint8_t) override { return 0; }
+        void flush() override {}
+
+    private:
+        // Serializes the document, keeping the length bytes that start at offset.
+        size_t copy(char* buffer, size_t offset, size_t length) const;
+
+        const JsonDocument& _body;
+        const size_t _length;
+        size_t _offset = 0;
+    };
+}
+
+#endif //_DISCORD_ESP32A_REQUESTSTREAM_H_
@@ -0,0 +1,88 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+
+#ifndef _DISCORD_ESP32A_RESPONSESTREAM_H_
+#define _DISCORD_ESP32A_RESPONSESTREAM_H_
+
+namespace Discord {
+    /// @brief Reads a response body straight off the connection, so it can be deserialized without buffering it
+    /// in a String first. Bodies framed by Content-Length and by chunked transfer encoding are both handled.
+    /// Once the body has been read, or drain() has been called, the connection can be reused.
+    class ResponseStream : public Stream {
+    public:
+        /// @brief Headers to collect on a client, so chunked bodies can be told apart from ones that
+        /// last until the connection closes. Pass to HTTPClient::collectHeaders() before sending.
+        static const char* HEADERS[];
+        static const size_t HEADER_COUNT;
+
+        /// @param client A client whose request has been sent and whose response headers have been read.
+        explicit ResponseStream(HTTPClient& client);
+
+        int available() override;
+        int read() override;
+        int peek() override;
+        size_t readBytes(char* buffer, size_t length) override;
+
+        // Responses are read-only.
+        size_t write(uint8_t) override { return 0; }
+        void flush() override {}
+
+        /// @brief Discards whatever is left of the body.
+        /// @return false if the body could not be read to its end, in which case the connection is closed.
+        bool drain();
+
+        /// @brief Whether the whole body has been read.
+        bool finished() const { return _state == State::Done; }
+
+        /// @brief Body bytes read so far.
+        size_t consumed() const { return _consumed; }
+
+    private:
+        enum class State {
+            // Reading a body of known length.
+            Sized,
+            // Expecting a chunk size line.
+            ChunkHeader,
+            // Reading chunk data.
+            ChunkData,
+            // Reading until the server closes the connection.
+            UntilClose,
+            Done,
+            Failed
+        };
+
+        // Waits up to the client timeout for a byte from the connection.
+        int nextRaw();
+        bool readChunkHeader();
+        bool skipLine();
+        void fail();
+
+        HTTPClient& _client;
+        WiFiClient* _stream;
+        State _state;
+        // Bytes left in the body or the current chunk.
+        size_t _remaining = 0;
+        size_t _consumed = 0;
+        int _peeked = -1;
+    };
+}
+
+#endif //_DISCORD_ESP32A_RESPONSESTREAM_H_
@@ -0,0 +1,43 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+
+#ifndef _DISCORD_ESP32A_SIGNATURE_H_
+#define _DISCORD_ESP32A_SIGNATURE_H_
+
+// Verifies the Ed25519 signatures Discord puts on interactions it POSTs to an endpoint, with libsodium.
+// Nothing here depends on the rest of the bot, so it builds and can be checked against libsodium on any host.
+namespace Discord::Signature {
+    constexpr size_t PUBLIC_KEY_SIZE = 32;
+    constexpr size_t SIGNATURE_SIZE = 64;
+
+    /// @brief Prepares libsodium. Safe to call more than once.
+    /// @return false if libsodium could not be initialised, in which case nothing verifies.
+    bool begin();
+
+    /// @brief Decodes a hex string of exactly 2 * size digits.
+    bool decodeHex(const char* hex, uint8_t* out, size_t size);
+
+    /// @brief Checks the X-Signature-Ed25519 header against the X-Signature-Timestamp header followed by the body.
+    /// @param publicKey The application's public key, from the developer portal.
+    /// @param signature The signature as sent, in hex.
+    bool verify(const uint8_t* publicKey, const char* signature, const char* timestamp, const char* body, size_t length);
+}
+
+#endif //_DISCORD_ESP32A_SIGNATURE_H_
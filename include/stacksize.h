@@ -0,0 +1,67 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <Arduino.h>
+
+#ifndef _DISCORD_ESP32A_STACKSIZE_H_
+#define _DISCORD_ESP32A_STACKSIZE_H_
+
+// Extra stack given on top of the most a task has been seen to use, for paths it has not taken yet.
+#ifndef DISCORD_STACK_MARGIN
+#define DISCORD_STACK_MARGIN 1024
+#endif
+// No task is sized below this, however little it has been seen to use.
+#ifndef DISCORD_STACK_MIN
+#define DISCORD_STACK_MIN 1536
+#endif
+// Set to 0 to always create tasks with their default stack, while still recording what they use.
+#ifndef DISCORD_STACK_AUTOSIZE
+#define DISCORD_STACK_AUTOSIZE 1
+#endif
+
+// Sizes the stacks of the tasks the library creates from what they have been seen to use.
+// The most stack each task has used is kept in NVS, so a reboot starts from the last build's observations
+// rather than the compiled-in defaults. Observations from a different firmware image are discarded.
+// A task keeps its default until it has been seen taking its deepest path, e.g. a TLS handshake, since usage from
+// shallower runs would size it too small for that. Off ESP32 nothing is persisted.
+namespace Discord::Stack {
+    enum class Task : uint8_t {
+        Post,
+        Log
+    };
+    constexpr size_t TASK_COUNT = 2;
+
+    /// @brief Stack to create a task with: the most it has been seen to use plus DISCORD_STACK_MARGIN,
+    /// or fallback until it has been seen taking its deepest path.
+    uint32_t size(Task task, uint32_t fallback);
+
+    /// @brief Records what a task has used. Call from the task itself, on its way out or periodically.
+    /// @param allocated The stack the task was created with.
+    /// @param unused The task's high-water mark, from uxTaskGetStackHighWaterMark().
+    /// @param deepest Whether this run took the task's deepest path, so its usage can be trusted for sizing.
+    void record(Task task, uint32_t allocated, uint32_t unused, bool deepest = true);
+
+    /// @brief The most stack a task has been seen to use, in this run or a previous one of the same build.
+    uint32_t observed(Task task);
+
+    /// @brief Writes any new maxima to NVS. Cheap when nothing has changed, call it from the main loop.
+    void save();
+}
+
+#endif //_DISCORD_ESP32A_STACKSIZE_H_
@@ -0,0 +1,112 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Arduino.h"
+
+HardwareSerial Serial;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const Clock::time_point start = Clock::now();
+    std::atomic<unsigned long long> skippedUs { 0 };
+
+    std::mutex tasksMtx;
+    bool taskThreads = false;
+    std::vector<std::thread> tasks;
+
+    std::mt19937& generator() {
+        static std::mt19937 instance { 1 };
+        return instance;
+    }
+
+    unsigned long long elapsedUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count() +
+            skippedUs.load(std::memory_order_relaxed);
+    }
+}
+
+unsigned long millis() {
+    return elapsedUs() / 1000;
+}
+
+unsigned long micros() {
+    return elapsedUs();
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+long random(long max) {
+    return random(0, max);
+}
+
+long random(long min, long max) {
+    if (max <= min) return min;
+    return std::uniform_int_distribution<long>(min, max - 1)(generator());
+}
+
+void randomSeed(unsigned long seed) {
+    generator().seed(seed);
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char*, uint32_t, void* parameter, UBaseType_t, TaskHandle_t* handle) {
+    if (handle) *handle = nullptr;
+    std::unique_lock<std::mutex> lock(tasksMtx);
+    if (taskThreads) {
+        tasks.emplace_back(task, parameter);
+        return pdPASS;
+    }
+    lock.unlock();
+    task(parameter);
+    return pdPASS;
+}
+
+namespace ArduinoNative {
+    void advanceClock(unsigned long ms) {
+        skippedUs.fetch_add(static_cast<unsigned long long>(ms) * 1000, std::memory_order_relaxed);
+    }
+
+    void runTasksOnThreads(bool threads) {
+        std::vector<std::thread> running;
+        {
+            std::lock_guard<std::mutex> lock(tasksMtx);
+            taskThreads = threads;
+            if (!threads) running.swap(tasks);
+        }
+        for (std::thread& task : running) {
+            task.join();
+        }
+    }
+}
@@ -0,0 +1,99 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+#include "HardwareSerial.h"
+#include "IPAddress.h"
+#include "Print.h"
+#include "Stream.h"
+#include "WString.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_ARDUINO_H_
+#define _DISCORD_ESP32A_NATIVE_ARDUINO_H_
+
+// The parts of the Arduino core and FreeRTOS the bot uses, for building it on a desktop OS.
+// Time is real, but can be moved forward by advanceClock() to skip waits such as heartbeat intervals.
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define DEC 10
+#define HEX 16
+
+using std::max;
+using std::min;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+
+// Setting the clock over SNTP is left to the OS.
+inline void configTime(long, int, const char*, const char* = nullptr, const char* = nullptr) {}
+
+#if defined(__GLIBC__) && !(__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 38))
+inline size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size > 0) {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, copied);
+        dst[copied] = '\0';
+    }
+    return length;
+}
+#endif
+
+// FreeRTOS, with ticks of 1ms. Tasks run in place, or on threads with ArduinoNative::runTasksOnThreads(). Either way
+// they have no stack of their own, so stack high-water marks read 0, i.e. unknown.
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define portTICK_PERIOD_MS 1
+#define pdPASS 1
+#define tskIDLE_PRIORITY 0
+
+inline void vTaskDelay(TickType_t ticks) { delay(ticks); }
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+BaseType_t xTaskCreate(TaskFunction_t task, const char* name, uint32_t stack, void* parameter, UBaseType_t priority,
+    TaskHandle_t* handle);
+
+namespace ArduinoNative {
+    /// @brief Moves millis() and micros() forward without waiting, e.g. past a heartbeat interval or a backoff.
+    void advanceClock(unsigned long ms);
+    /// @brief Runs tasks created from now on each on a thread of its own, alongside the caller as FreeRTOS would,
+    /// instead of in place. Turning it off waits for those still running.
+    void runTasksOnThreads(bool threads);
+}
+
+#endif //_DISCORD_ESP32A_NATIVE_ARDUINO_H_
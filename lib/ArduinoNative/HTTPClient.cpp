@@ -0,0 +1,300 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <strings.h>
+
+#include "HTTPClient.h"
+
+namespace ArduinoNative {
+    namespace {
+        HttpHost* httpHost = nullptr;
+    }
+
+    void setHttpHost(HttpHost* host) {
+        httpHost = host;
+    }
+
+    String HttpRequest::header(const char* name) const {
+        for (const auto& h : headers) {
+            if (h.first.equalsIgnoreCase(name)) return h.second;
+        }
+        return String();
+    }
+}
+
+namespace {
+    // Reads a line up to CRLF, without it.
+    String readLine(WiFiClient& client) {
+        String line;
+        int c;
+        while ((c = client.read()) >= 0 && c != '\n') {
+            if (c != '\r') line += static_cast<char>(c);
+        }
+        return line;
+    }
+}
+
+bool HTTPClient::begin(String url, const char*) {
+    int scheme = url.indexOf("://");
+    if (scheme < 0) return false;
+    String protocol = url.substring(0, scheme);
+    url = url.substring(scheme + 3);
+
+    int slash = url.indexOf('/');
+    String host = slash < 0 ? url : url.substring(0, slash);
+    String uri = slash < 0 ? String("/") : url.substring(slash);
+    uint16_t port = protocol.equalsIgnoreCase("https") ? 443 : 80;
+    int colon = host.indexOf(':');
+    if (colon >= 0) {
+        port = static_cast<uint16_t>(host.substring(colon + 1).toInt());
+        host = host.substring(0, colon);
+    }
+
+    // A connection to somewhere else cannot be reused.
+    if (host != _host || port != _port) {
+        disconnect();
+    }
+    _host = host;
+    _port = port;
+    _uri = uri;
+    clear();
+    return true;
+}
+
+void HTTPClient::end() {
+    disconnect();
+    clear();
+}
+
+bool HTTPClient::connected() {
+    if (_connection == 0) return false;
+    // Like a socket, what was received can still be read after the peer has gone.
+    if (_client.available() > 0) return true;
+    return _client.connected() && ArduinoNative::httpHost && ArduinoNative::httpHost->alive(_connection);
+}
+
+bool HTTPClient::setURL(const String& url) {
+    if (url.startsWith("http://") || url.startsWith("https://")) {
+        return begin(url);
+    }
+    // A path on the same host, keeping the connection.
+    _uri = url.startsWith("/") ? url : String("/") + url;
+    clear();
+    return true;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool first, bool replace) {
+    if (replace) {
+        for (auto& h : _headers) {
+            if (h.first.equalsIgnoreCase(name.c_str())) {
+                h.second = value;
+                return;
+            }
+        }
+    }
+    if (first) {
+        _headers.insert(_headers.begin(), { name, value });
+    }
+    else {
+        _headers.push_back({ name, value });
+    }
+}
+
+void HTTPClient::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    _collect.assign(headerKeys, headerKeys + headerKeysCount);
+}
+
+String HTTPClient::header(const char* name) {
+    for (const auto& h : _responseHeaders) {
+        if (h.first.equalsIgnoreCase(name)) return h.second;
+    }
+    return String();
+}
+
+bool HTTPClient::hasHeader(const char* name) {
+    for (const auto& h : _responseHeaders) {
+        if (h.first.equalsIgnoreCase(name)) return true;
+    }
+    return false;
+}
+
+int HTTPClient::sendRequest(const char* type, String payload) {
+    return send(type, payload);
+}
+
+int HTTPClient::sendRequest(const char* type, uint8_t* payload, size_t size) {
+    return send(type, payload ? String(reinterpret_cast<const char*>(payload), size) : String());
+}
+
+int HTTPClient::sendRequest(const char* type, Stream* stream, size_t size) {
+    if (stream == nullptr) return HTTPC_ERROR_NO_STREAM;
+    // Read in the blocks the real client writes to its socket.
+    String body;
+    body.reserve(size);
+    uint8_t buffer[HTTP_TCP_BUFFER_SIZE];
+    while (body.length() < size) {
+        int available = stream->available();
+        if (available <= 0) break;
+        size_t toRead = std::min({ static_cast<size_t>(available), sizeof(buffer), size - body.length() });
+        size_t read = stream->readBytes(buffer, toRead);
+        if (read == 0) break;
+        body.concat(reinterpret_cast<const char*>(buffer), read);
+    }
+    if (body.length() != size) return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    return send(type, body);
+}
+
+int HTTPClient::send(const char* type, const String& body) {
+    if (!connect()) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+    ArduinoNative::HttpRequest request;
+    request.method = type;
+    request.host = _host;
+    request.path = _uri;
+    request.headers.push_back({ "Host", _host });
+    request.headers.push_back({ "User-Agent", "ESP32HTTPClient" });
+    request.headers.push_back({ "Connection", _reuse ? "keep-alive" : "close" });
+    if (body.length() > 0) {
+        request.headers.push_back({ "Content-Length", String(static_cast<unsigned>(body.length())) });
+    }
+    request.headers.insert(request.headers.end(), _headers.begin(), _headers.end());
+    request.body = body;
+
+    String response;
+    if (!ArduinoNative::httpHost->handle(_connection, request, response)) {
+        disconnect();
+        return HTTPC_ERROR_CONNECTION_LOST;
+    }
+    _client.receive(response.c_str(), response.length());
+    if (!readResponseHeaders()) {
+        disconnect();
+        return HTTPC_ERROR_NO_HTTP_SERVER;
+    }
+    return _returnCode;
+}
+
+bool HTTPClient::connect() {
+    if (connected()) {
+        // Leftovers from the last response would be read as this one.
+        while (_client.available() > 0) {
+            _client.read();
+        }
+        return true;
+    }
+    disconnect();
+    if (ArduinoNative::httpHost == nullptr) return false;
+    _connection = ArduinoNative::httpHost->open(_host, _port);
+    if (_connection == 0) return false;
+    _client.open();
+    return true;
+}
+
+void HTTPClient::disconnect() {
+    if (_connection != 0 && ArduinoNative::httpHost) {
+        ArduinoNative::httpHost->close(_connection);
+    }
+    _connection = 0;
+    _client.stop();
+}
+
+void HTTPClient::clear() {
+    _headers.clear();
+    _responseHeaders.clear();
+    _returnCode = 0;
+    _size = -1;
+}
+
+bool HTTPClient::readResponseHeaders() {
+    _responseHeaders.clear();
+    _size = -1;
+    String status = readLine(_client);
+    if (!status.startsWith("HTTP/1.")) return false;
+    _returnCode = static_cast<int>(status.substring(9, 12).toInt());
+    if (_returnCode <= 0) return false;
+
+    bool close = !_reuse;
+    for (;;) {
+        String line = readLine(_client);
+        if (line.isEmpty()) break;
+        int colon = line.indexOf(':');
+        if (colon < 0) continue;
+        String name = line.substring(0, colon);
+        String value = line.substring(colon + 1);
+        value.trim();
+
+        if (name.equalsIgnoreCase("Content-Length")) {
+            _size = static_cast<int>(value.toInt());
+        }
+        else if (name.equalsIgnoreCase("Connection")) {
+            close = close || value.equalsIgnoreCase("close");
+        }
+        for (const String& key : _collect) {
+            if (name.equalsIgnoreCase(key.c_str())) {
+                _responseHeaders.push_back({ key, value });
+            }
+        }
+    }
+    if (close) {
+        _client.closeByPeer();
+    }
+    return true;
+}
+
+String HTTPClient::getString() {
+    String body;
+    if (_size >= 0) {
+        while (body.length() < static_cast<size_t>(_size) && _client.available() > 0) {
+            body += static_cast<char>(_client.read());
+        }
+        return body;
+    }
+    if (!header("Transfer-Encoding").equalsIgnoreCase("chunked")) {
+        while (_client.available() > 0) {
+            body += static_cast<char>(_client.read());
+        }
+        return body;
+    }
+    for (;;) {
+        String size = readLine(_client);
+        long length = strtol(size.c_str(), nullptr, 16);
+        if (length <= 0) break;
+        for (long i = 0; i < length && _client.available() > 0; ++i) {
+            body += static_cast<char>(_client.read());
+        }
+        readLine(_client);
+    }
+    readLine(_client);
+    return body;
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+        case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+        case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+        case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+        case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+        case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+        case HTTPC_ERROR_NO_STREAM: return "no stream";
+        case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+        case HTTPC_ERROR_TOO_LESS_RAM: return "too less ram";
+        case HTTPC_ERROR_ENCODING: return "Transfer-Encoding not supported";
+        case HTTPC_ERROR_STREAM_WRITE: return "Stream write error";
+        case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+        default: return String();
+    }
+}
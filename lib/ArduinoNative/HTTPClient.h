@@ -0,0 +1,148 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_HTTPCLIENT_H_
+#define _DISCORD_ESP32A_NATIVE_HTTPCLIENT_H_
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+#define HTTP_TCP_BUFFER_SIZE (1460)
+
+typedef enum {
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_CREATED = 201,
+    HTTP_CODE_NO_CONTENT = 204,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_UNAUTHORIZED = 401,
+    HTTP_CODE_FORBIDDEN = 403,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_TOO_MANY_REQUESTS = 429,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+    HTTP_CODE_SERVICE_UNAVAILABLE = 503
+} t_http_codes;
+
+namespace ArduinoNative {
+    typedef std::vector<std::pair<String, String>> Headers;
+
+    struct HttpRequest {
+        String method;
+        String host;
+        String path;
+        Headers headers;
+        String body;
+
+        /// @brief The value of a header, matched without case, or an empty string.
+        String header(const char* name) const;
+    };
+
+    /// @brief What HTTPClient talks to in place of the network, such as a mock server.
+    /// Connections are identified by a number the host hands out, and are kept alive until either side closes them.
+    class HttpHost {
+    public:
+        virtual ~HttpHost() = default;
+
+        /// @brief Opens a connection, TLS handshake included.
+        /// @return The connection, or 0 if it was refused.
+        virtual uint32_t open(const String& host, uint16_t port) = 0;
+        /// @brief Whether the host still has a connection open, e.g. it has not timed it out while idle.
+        virtual bool alive(uint32_t connection) = 0;
+        virtual void close(uint32_t connection) = 0;
+        /// @brief Answers a request with a whole HTTP/1.1 response: status line, headers and body.
+        /// A response with "Connection: close" closes the connection once it is read.
+        /// @return false if the connection was dropped without a response.
+        virtual bool handle(uint32_t connection, const HttpRequest& request, String& response) = 0;
+    };
+
+    /// @brief Routes every HTTPClient to a host, nullptr to refuse every connection.
+    void setHttpHost(HttpHost* host);
+}
+
+/// @brief arduino-esp32's HTTPClient, sending to the HttpHost set with ArduinoNative::setHttpHost().
+/// The response body is left on the stream as received, so chunked bodies come with their framing.
+class HTTPClient {
+public:
+    HTTPClient() = default;
+    ~HTTPClient() { end(); }
+
+    bool begin(String url, const char* CAcert = nullptr);
+    void end();
+    bool connected();
+    bool setURL(const String& url);
+
+    void setReuse(bool reuse) { _reuse = reuse; }
+    void setTimeout(uint16_t timeout) { _client.setTimeout(timeout); }
+    void setConnectTimeout(int32_t) {}
+
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const char* name);
+    bool hasHeader(const char* name);
+
+    int GET() { return sendRequest("GET"); }
+    int POST(const String& payload) { return sendRequest("POST", payload); }
+    int sendRequest(const char* type, String payload);
+    int sendRequest(const char* type, uint8_t* payload = nullptr, size_t size = 0);
+    int sendRequest(const char* type, Stream* stream, size_t size = 0);
+
+    int getSize() { return _size; }
+    WiFiClient& getStream() { return _client; }
+    WiFiClient* getStreamPtr() { return connected() ? &_client : nullptr; }
+    String getString();
+
+    static String errorToString(int error);
+
+private:
+    bool connect();
+    void disconnect();
+    // Drops the request headers and what was known of the last response.
+    void clear();
+    bool readResponseHeaders();
+    int send(const char* type, const String& body);
+
+    String _host;
+    uint16_t _port = 443;
+    String _uri = "/";
+    bool _reuse = true;
+
+    ArduinoNative::Headers _headers;
+    std::vector<String> _collect;
+    ArduinoNative::Headers _responseHeaders;
+    int _returnCode = 0;
+    int _size = -1;
+
+    uint32_t _connection = 0;
+    WiFiClient _client;
+};
+
+#endif //_DISCORD_ESP32A_NATIVE_HTTPCLIENT_H_
@@ -0,0 +1,67 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <cstdio>
+
+#include "Print.h"
+#include "WString.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_IPADDRESS_H_
+#define _DISCORD_ESP32A_NATIVE_IPADDRESS_H_
+
+/// @brief An IPv4 address, stored in network order like Arduino's.
+class IPAddress {
+public:
+    IPAddress() : IPAddress(0, 0, 0, 0) {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _bytes { a, b, c, d } {}
+    IPAddress(uint32_t address) {
+        for (int i = 0; i < 4; ++i) _bytes[i] = (address >> (8 * i)) & 0xFF;
+    }
+
+    operator uint32_t() const {
+        return _bytes[0] | (_bytes[1] << 8) | (_bytes[2] << 16) | (static_cast<uint32_t>(_bytes[3]) << 24);
+    }
+    uint8_t operator[](int index) const { return _bytes[index]; }
+    uint8_t& operator[](int index) { return _bytes[index]; }
+    bool operator==(const IPAddress& other) const { return static_cast<uint32_t>(*this) == static_cast<uint32_t>(other); }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+
+    bool fromString(const char* address) {
+        unsigned a, b, c, d;
+        char extra;
+        if (sscanf(address, "%u.%u.%u.%u%c", &a, &b, &c, &d, &extra) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        *this = IPAddress(a, b, c, d);
+        return true;
+    }
+
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+        return String(text);
+    }
+
+    size_t printTo(Print& p) const { return p.print(toString()); }
+
+private:
+    uint8_t _bytes[4];
+};
+
+#endif //_DISCORD_ESP32A_NATIVE_IPADDRESS_H_
@@ -0,0 +1,81 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "LocalClient.h"
+
+namespace ArduinoNative {
+    LocalResponse request(uint16_t port, const char* method, const String& path,
+        const std::vector<std::pair<String, String>>& headers, const String& body,
+        const std::function<void()>& service, unsigned long timeout) {
+        LocalResponse response;
+        int connection = socket(AF_INET, SOCK_STREAM, 0);
+        if (connection < 0) return response;
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(port);
+        if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(connection);
+            return response;
+        }
+
+        String request(method);
+        request += " ";
+        request += path;
+        request += " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n";
+        for (const auto& h : headers) {
+            request += h.first;
+            request += ": ";
+            request += h.second;
+            request += "\r\n";
+        }
+        request += "Content-Length: ";
+        request += String(static_cast<unsigned>(body.length()));
+        request += "\r\n\r\n";
+        request += body;
+        // Small enough for the socket buffer, so it is sent before the server is run.
+        send(connection, request.c_str(), request.length(), MSG_NOSIGNAL);
+
+        std::string raw;
+        char buffer[4096];
+        unsigned long start = millis();
+        for (;;) {
+            service();
+            ssize_t received = recv(connection, buffer, sizeof(buffer), MSG_DONTWAIT);
+            if (received > 0) {
+                raw.append(buffer, received);
+                continue;
+            }
+            if (received == 0 || millis() - start > timeout) break;
+            delay(1);
+        }
+        close(connection);
+
+        size_t headerEnd = raw.find("\r\n\r\n");
+        if (raw.compare(0, 7, "HTTP/1.") != 0 || headerEnd == std::string::npos) return response;
+        response.status = atoi(raw.c_str() + 9);
+        response.body = String(raw.substr(headerEnd + 4));
+        return response;
+    }
+}
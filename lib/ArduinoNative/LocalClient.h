@@ -0,0 +1,42 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_LOCALCLIENT_H_
+#define _DISCORD_ESP32A_NATIVE_LOCALCLIENT_H_
+
+namespace ArduinoNative {
+    struct LocalResponse {
+        // 0 if no response came.
+        int status = 0;
+        String body;
+    };
+
+    /// @brief Sends a request to a WebServer on this host, such as the one in main.cpp, and waits for its answer.
+    /// The server is run by calling service until the answer comes, so tests need no second thread.
+    LocalResponse request(uint16_t port, const char* method, const String& path,
+        const std::vector<std::pair<String, String>>& headers, const String& body,
+        const std::function<void()>& service, unsigned long timeout = 5000);
+}
+
+#endif //_DISCORD_ESP32A_NATIVE_LOCALCLIENT_H_
@@ -0,0 +1,74 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Arduino.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_M5ATOM_H_
+#define _DISCORD_ESP32A_NATIVE_M5ATOM_H_
+
+/// @brief The Atom's button, pressed and released by tests instead of a finger.
+/// Like the real one, what it reports only changes on M5.update().
+class Button {
+public:
+    bool isPressed() const { return _state; }
+    bool isReleased() const { return !_state; }
+    bool wasPressed() const { return _state && _changed; }
+    bool wasReleased() const { return !_state && _changed; }
+    bool pressedFor(uint32_t ms) const { return _state && _time - _lastChange >= ms; }
+    bool releasedFor(uint32_t ms) const { return !_state && _time - _lastChange >= ms; }
+    bool wasReleasefor(uint32_t ms) const { return !_state && _changed && _time - _pressTime >= ms; }
+
+    // The test's side.
+
+    void press() { _pressed = true; }
+    void release() { _pressed = false; }
+
+    void read();
+
+private:
+    bool _pressed = false;
+    bool _state = false;
+    bool _changed = false;
+    unsigned long _time = 0;
+    unsigned long _lastChange = 0;
+    unsigned long _pressTime = 0;
+};
+
+/// @brief The Atom's single LED, remembering the colour last drawn.
+class LED_Display {
+public:
+    void drawpix(uint8_t, uint32_t colour) { _colour = colour; }
+    void clear() { _colour = 0; }
+    uint32_t colour() const { return _colour; }
+
+private:
+    uint32_t _colour = 0;
+};
+
+class M5Atom {
+public:
+    void begin(bool = true, bool = true, bool = true) {}
+    void update() { Btn.read(); }
+
+    Button Btn;
+    LED_Display dis;
+};
+
+extern M5Atom M5;
+
+#endif //_DISCORD_ESP32A_NATIVE_M5ATOM_H_
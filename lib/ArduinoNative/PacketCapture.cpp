@@ -0,0 +1,83 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <arpa/inet.h>
+#include <ctime>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "PacketCapture.h"
+#include "WiFiUdp.h"
+
+namespace ArduinoNative {
+    PacketCapture::PacketCapture() {
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        if (_socket < 0) return;
+        int on = 1;
+        setsockopt(_socket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (bind(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            getsockname(_socket, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            close(_socket);
+            _socket = -1;
+            return;
+        }
+        _port = ntohs(address.sin_port);
+        WiFiUDP::redirect(_port);
+    }
+
+    PacketCapture::~PacketCapture() {
+        WiFiUDP::redirect(0);
+        if (_socket >= 0) {
+            close(_socket);
+        }
+    }
+
+    CapturedPacket PacketCapture::receive(unsigned long timeout) {
+        CapturedPacket packet;
+        pollfd readable = { _socket, POLLIN, 0 };
+        if (_socket < 0 || poll(&readable, 1, static_cast<int>(timeout)) <= 0) return packet;
+
+        char buffer[1500];
+        char control[CMSG_SPACE(sizeof(timespec))];
+        iovec data = { buffer, sizeof(buffer) };
+        msghdr message = {};
+        message.msg_iov = &data;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        ssize_t received = recvmsg(_socket, &message, 0);
+        if (received < 0) return packet;
+
+        packet.data.assign(buffer, received);
+        for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr; header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_TIMESTAMPNS) {
+                const timespec* at = reinterpret_cast<const timespec*>(CMSG_DATA(header));
+                packet.receivedNs = static_cast<uint64_t>(at->tv_sec) * 1000000000ULL + at->tv_nsec;
+            }
+        }
+        return packet;
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstdint>
+#include <string>
+
+#ifndef _DISCORD_ESP32A_NATIVE_PACKETCAPTURE_H_
+#define _DISCORD_ESP32A_NATIVE_PACKETCAPTURE_H_
+
+namespace ArduinoNative {
+    struct CapturedPacket {
+        // Empty if no packet came.
+        std::string data;
+        // When the kernel received it, in ns of CLOCK_REALTIME.
+        uint64_t receivedNs = 0;
+    };
+
+    /// @brief A local UDP socket that every packet sent through WiFiUDP is redirected to while it exists, so tests
+    /// can read back what would have gone out on the LAN. Where each was addressed is kept by WiFiUDP.
+    class PacketCapture {
+    public:
+        PacketCapture();
+        ~PacketCapture();
+        PacketCapture(const PacketCapture&) = delete;
+        PacketCapture& operator=(const PacketCapture&) = delete;
+
+        /// @brief Waits for the next packet.
+        CapturedPacket receive(unsigned long timeout = 1000);
+
+        uint16_t port() const { return _port; }
+    private:
+        int _socket = -1;
+        uint16_t _port = 0;
+    };
+}
+
+#endif //_DISCORD_ESP32A_NATIVE_PACKETCAPTURE_H_
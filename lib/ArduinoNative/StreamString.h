@@ -0,0 +1,47 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Stream.h"
+#include "WString.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_STREAMSTRING_H_
+#define _DISCORD_ESP32A_NATIVE_STREAMSTRING_H_
+
+/// @brief A String that can be printed to, and read back from the front.
+class StreamString : public Stream, public String {
+public:
+    size_t write(uint8_t c) override {
+        concat(static_cast<char>(c));
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        concat(reinterpret_cast<const char*>(buffer), size);
+        return size;
+    }
+
+    int available() override { return length(); }
+    int read() override {
+        if (isEmpty()) return -1;
+        char c = (*this)[0];
+        *static_cast<String*>(this) = substring(1);
+        return static_cast<uint8_t>(c);
+    }
+    int peek() override { return isEmpty() ? -1 : static_cast<uint8_t>((*this)[0]); }
+};
+
+#endif //_DISCORD_ESP32A_NATIVE_STREAMSTRING_H_
@@ -0,0 +1,91 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <strings.h>
+
+#include "WString.h"
+
+namespace {
+    std::string digits(unsigned long long value, unsigned char base) {
+        if (base < 2 || base > 36) base = 10;
+        std::string out;
+        do {
+            unsigned digit = value % base;
+            out.insert(out.begin(), static_cast<char>(digit < 10 ? '0' + digit : 'a' + digit - 10));
+            value /= base;
+        } while (value > 0);
+        return out;
+    }
+}
+
+String::String(long long value, unsigned char base) {
+    if (value < 0 && base == 10) {
+        _s = "-" + digits(-static_cast<unsigned long long>(value), base);
+    }
+    else {
+        _s = digits(static_cast<unsigned long long>(value), base);
+    }
+}
+
+String::String(unsigned long long value, unsigned char base) : _s { digits(value, base) } {}
+
+String::String(double value, unsigned int decimals) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", static_cast<int>(decimals), value);
+    _s = buffer;
+}
+
+bool String::equalsIgnoreCase(const String& str) const {
+    return _s.length() == str._s.length() && strcasecmp(_s.c_str(), str._s.c_str()) == 0;
+}
+
+void String::toLowerCase() {
+    for (char& c : _s) c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+}
+
+void String::toUpperCase() {
+    for (char& c : _s) c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+}
+
+void String::replace(const String& find, const String& replacement) {
+    if (find._s.empty()) return;
+    for (size_t at = _s.find(find._s); at != std::string::npos; at = _s.find(find._s, at + replacement._s.length())) {
+        _s.replace(at, find._s.length(), replacement._s);
+    }
+}
+
+void String::trim() {
+    size_t first = _s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        _s.clear();
+        return;
+    }
+    size_t last = _s.find_last_not_of(" \t\r\n");
+    _s = _s.substr(first, last - first + 1);
+}
+
+long String::toInt() const {
+    return strtol(_s.c_str(), nullptr, 10);
+}
+
+float String::toFloat() const {
+    return strtof(_s.c_str(), nullptr);
+}
@@ -0,0 +1,163 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef _DISCORD_ESP32A_NATIVE_WSTRING_H_
+#define _DISCORD_ESP32A_NATIVE_WSTRING_H_
+
+// Flash strings are ordinary ones off-device.
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper*>(string_literal))
+
+/// @brief Arduino's String over std::string, with the members the bot and its libraries use.
+class String {
+public:
+    String() = default;
+    String(const char* str) : _s { str ? str : "" } {}
+    String(const char* str, size_t length) : _s { str ? std::string(str, length) : std::string() } {}
+    String(const std::string& str) : _s { str } {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int value, unsigned char base = 10) : String(static_cast<long long>(value), base) {}
+    explicit String(unsigned int value, unsigned char base = 10) : String(static_cast<unsigned long long>(value), base) {}
+    explicit String(long value, unsigned char base = 10) : String(static_cast<long long>(value), base) {}
+    explicit String(unsigned long value, unsigned char base = 10) : String(static_cast<unsigned long long>(value), base) {}
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(double value, unsigned int decimals = 2);
+
+    bool reserve(size_t size) {
+        _s.reserve(size);
+        return true;
+    }
+    size_t length() const { return _s.length(); }
+    bool isEmpty() const { return _s.empty(); }
+    void clear() { _s.clear(); }
+    const char* c_str() const { return _s.c_str(); }
+    char* begin() { return &_s[0]; }
+    char* end() { return &_s[0] + _s.length(); }
+    const char* begin() const { return _s.c_str(); }
+    const char* end() const { return _s.c_str() + _s.length(); }
+
+    bool concat(const String& str) {
+        _s += str._s;
+        return true;
+    }
+    bool concat(const char* str) {
+        if (str == nullptr) return false;
+        _s += str;
+        return true;
+    }
+    bool concat(const char* str, size_t length) {
+        if (str == nullptr) return false;
+        _s.append(str, length);
+        return true;
+    }
+    bool concat(char c) {
+        _s += c;
+        return true;
+    }
+    template <typename T>
+    bool concat(T value) { return concat(String(value)); }
+
+    String& operator+=(const String& str) { concat(str); return *this; }
+    String& operator+=(const char* str) { concat(str); return *this; }
+    String& operator+=(char c) { concat(c); return *this; }
+    template <typename T>
+    String& operator+=(T value) { concat(String(value)); return *this; }
+
+    char operator[](size_t index) const { return index < _s.length() ? _s[index] : '\0'; }
+    char& operator[](size_t index) { return _s[index]; }
+    char charAt(size_t index) const { return (*this)[index]; }
+    void setCharAt(size_t index, char c) {
+        if (index < _s.length()) _s[index] = c;
+    }
+
+    bool equals(const String& str) const { return _s == str._s; }
+    bool equals(const char* str) const { return _s == (str ? str : ""); }
+    bool equalsIgnoreCase(const String& str) const;
+    bool startsWith(const String& prefix) const { return _s.compare(0, prefix._s.length(), prefix._s) == 0; }
+    bool endsWith(const String& suffix) const {
+        return _s.length() >= suffix._s.length() &&
+            _s.compare(_s.length() - suffix._s.length(), suffix._s.length(), suffix._s) == 0;
+    }
+
+    int indexOf(char c, size_t from = 0) const { return position(_s.find(c, from)); }
+    int indexOf(const String& str, size_t from = 0) const { return position(_s.find(str._s, from)); }
+    int lastIndexOf(char c) const { return position(_s.rfind(c)); }
+    String substring(size_t from) const { return from < _s.length() ? String(_s.substr(from)) : String(); }
+    String substring(size_t from, size_t to) const {
+        if (from > to) std::swap(from, to);
+        return from < _s.length() ? String(_s.substr(from, to - from)) : String();
+    }
+
+    void replace(const String& find, const String& replacement);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+    long toInt() const;
+    float toFloat() const;
+
+    bool operator==(const String& str) const { return equals(str); }
+    bool operator==(const char* str) const { return equals(str); }
+    bool operator!=(const String& str) const { return !equals(str); }
+    bool operator!=(const char* str) const { return !equals(str); }
+    bool operator<(const String& str) const { return _s < str._s; }
+
+    const std::string& str() const { return _s; }
+
+private:
+    static int position(size_t found) { return found == std::string::npos ? -1 : static_cast<int>(found); }
+
+    std::string _s;
+};
+
+// The type of a concatenation in the Arduino core, which ArduinoJson also accepts as a string.
+class StringSumHelper : public String {
+public:
+    using String::String;
+    StringSumHelper(const String& str) : String(str) {}
+};
+
+inline String operator+(const String& lhs, const String& rhs) {
+    String sum(lhs);
+    sum += rhs;
+    return sum;
+}
+
+inline String operator+(const String& lhs, const char* rhs) {
+    String sum(lhs);
+    sum += rhs;
+    return sum;
+}
+
+inline String operator+(const char* lhs, const String& rhs) {
+    String sum(lhs);
+    sum += rhs;
+    return sum;
+}
+
+inline String operator+(const String& lhs, char rhs) {
+    String sum(lhs);
+    sum += rhs;
+    return sum;
+}
+
+#endif //_DISCORD_ESP32A_NATIVE_WSTRING_H_
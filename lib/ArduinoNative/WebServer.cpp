@@ -0,0 +1,282 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "WebServer.h"
+
+namespace {
+    // -1 while servers listen on their own port.
+    int listenPort = -1;
+    uint16_t boundPort = 0;
+
+    const char* reason(int code) {
+        switch (code) {
+            case 200: return "OK";
+            case 201: return "Created";
+            case 204: return "No Content";
+            case 400: return "Bad Request";
+            case 401: return "Unauthorized";
+            case 404: return "Not Found";
+            case 500: return "Internal Server Error";
+            case 503: return "Service Unavailable";
+            default: return "";
+        }
+    }
+
+    int hex(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    String urlDecode(const String& text) {
+        String decoded;
+        for (size_t i = 0; i < text.length(); ++i) {
+            char c = text[i];
+            if (c == '+') {
+                decoded += ' ';
+            }
+            else if (c == '%' && i + 2 < text.length() && hex(text[i + 1]) >= 0 && hex(text[i + 2]) >= 0) {
+                decoded += static_cast<char>(hex(text[i + 1]) * 16 + hex(text[i + 2]));
+                i += 2;
+            }
+            else {
+                decoded += c;
+            }
+        }
+        return decoded;
+    }
+
+    HTTPMethod methodOf(const String& name) {
+        if (name == "GET") return HTTP_GET;
+        if (name == "HEAD") return HTTP_HEAD;
+        if (name == "POST") return HTTP_POST;
+        if (name == "PUT") return HTTP_PUT;
+        if (name == "PATCH") return HTTP_PATCH;
+        if (name == "DELETE") return HTTP_DELETE;
+        return HTTP_ANY;
+    }
+}
+
+void WebServer::begin() {
+    close();
+    _socket = socket(AF_INET, SOCK_STREAM, 0);
+    if (_socket < 0) return;
+    int on = 1;
+    setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(listenPort >= 0 ? listenPort : _port));
+    if (bind(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(_socket, 8) != 0) {
+        ::close(_socket);
+        _socket = -1;
+        return;
+    }
+    fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL) | O_NONBLOCK);
+
+    socklen_t length = sizeof(address);
+    getsockname(_socket, reinterpret_cast<sockaddr*>(&address), &length);
+    boundPort = ntohs(address.sin_port);
+}
+
+void WebServer::close() {
+    if (_socket >= 0) {
+        ::close(_socket);
+        _socket = -1;
+    }
+}
+
+void WebServer::handleClient() {
+    if (_socket < 0) return;
+    int connection = accept(_socket, nullptr, nullptr);
+    if (connection < 0) return;
+
+    timeval timeout = { 2, 0 };
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    _connection = connection;
+    if (!readRequest(connection)) {
+        send(400, "text/plain", "Bad request.");
+    }
+    else {
+        bool handled = false;
+        for (const Route& route : _routes) {
+            if (route.uri == _uri && (route.method == HTTP_ANY || route.method == _method)) {
+                route.fn();
+                handled = true;
+                break;
+            }
+        }
+        if (!handled) {
+            if (_notFound) {
+                _notFound();
+            }
+            else {
+                send(404, "text/plain", String("Not found: ") + _uri);
+            }
+        }
+    }
+    ::close(connection);
+    _connection = -1;
+}
+
+bool WebServer::readRequest(int connection) {
+    _args.clear();
+    _headers.clear();
+
+    std::string request;
+    size_t headerEnd;
+    char buffer[4096];
+    while ((headerEnd = request.find("\r\n\r\n")) == std::string::npos) {
+        ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        request.append(buffer, received);
+    }
+
+    String head(request.substr(0, headerEnd));
+    int lineEnd = head.indexOf("\r\n");
+    String requestLine = lineEnd < 0 ? head : head.substring(0, lineEnd);
+    int space = requestLine.indexOf(' ');
+    int secondSpace = requestLine.indexOf(' ', space + 1);
+    if (space < 0 || secondSpace < 0) return false;
+    _method = methodOf(requestLine.substring(0, space));
+    String target = requestLine.substring(space + 1, secondSpace);
+
+    int query = target.indexOf('?');
+    _uri = query < 0 ? target : target.substring(0, query);
+    if (query >= 0) {
+        String args = target.substring(query + 1);
+        int start = 0;
+        while (start < static_cast<int>(args.length())) {
+            int end = args.indexOf('&', start);
+            if (end < 0) end = args.length();
+            String pair = args.substring(start, end);
+            int equals = pair.indexOf('=');
+            if (equals < 0) {
+                _args.push_back({ urlDecode(pair), String() });
+            }
+            else {
+                _args.push_back({ urlDecode(pair.substring(0, equals)), urlDecode(pair.substring(equals + 1)) });
+            }
+            start = end + 1;
+        }
+    }
+
+    size_t contentLength = 0;
+    while (lineEnd >= 0) {
+        int start = lineEnd + 2;
+        lineEnd = head.indexOf("\r\n", start);
+        String line = lineEnd < 0 ? head.substring(start) : head.substring(start, lineEnd);
+        int colon = line.indexOf(':');
+        if (colon < 0) continue;
+        String name = line.substring(0, colon);
+        String value = line.substring(colon + 1);
+        value.trim();
+        if (name.equalsIgnoreCase("Content-Length")) {
+            contentLength = static_cast<size_t>(value.toInt());
+        }
+        for (const String& key : _collect) {
+            if (name.equalsIgnoreCase(key.c_str())) {
+                _headers.push_back({ key, value });
+            }
+        }
+    }
+
+    std::string body = request.substr(headerEnd + 4);
+    while (body.size() < contentLength) {
+        ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+        if (received <= 0) return false;
+        body.append(buffer, received);
+    }
+    if (!body.empty()) {
+        _args.push_back({ "plain", String(body.substr(0, contentLength)) });
+    }
+    return true;
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn) {
+    _routes.push_back({ uri, method, fn });
+}
+
+void WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    _collect.assign(headerKeys, headerKeys + headerKeysCount);
+}
+
+String WebServer::arg(const String& name) const {
+    for (const auto& a : _args) {
+        if (a.first == name) return a.second;
+    }
+    return String();
+}
+
+bool WebServer::hasArg(const String& name) const {
+    for (const auto& a : _args) {
+        if (a.first == name) return true;
+    }
+    return false;
+}
+
+String WebServer::header(const String& name) const {
+    for (const auto& h : _headers) {
+        if (h.first.equalsIgnoreCase(name.c_str())) return h.second;
+    }
+    return String();
+}
+
+bool WebServer::hasHeader(const String& name) const {
+    for (const auto& h : _headers) {
+        if (h.first.equalsIgnoreCase(name.c_str())) return true;
+    }
+    return false;
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+    if (_connection < 0) return;
+    String response("HTTP/1.1 ");
+    response += String(code);
+    response += " ";
+    response += reason(code);
+    response += "\r\nContent-Type: ";
+    response += contentType ? contentType : "text/html";
+    response += "\r\nContent-Length: ";
+    response += String(static_cast<unsigned>(content.length()));
+    response += "\r\nConnection: close\r\n\r\n";
+    response += content;
+
+    size_t sent = 0;
+    while (sent < response.length()) {
+        ssize_t written = ::send(_connection, response.c_str() + sent, response.length() - sent, MSG_NOSIGNAL);
+        if (written <= 0) break;
+        sent += written;
+    }
+}
+
+void WebServer::listenOn(uint16_t port) {
+    listenPort = port;
+}
+
+uint16_t WebServer::localPort() {
+    return boundPort;
+}
@@ -0,0 +1,99 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFiClient.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_WEBSERVER_H_
+#define _DISCORD_ESP32A_NATIVE_WEBSERVER_H_
+
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+    HTTP_PATCH = 28,
+    HTTP_ANY = 255
+} HTTPMethod;
+
+/// @brief arduino-esp32's WebServer, over a real TCP socket on the loopback interface.
+/// One request is handled per connection, answered with "Connection: close", as tests send one at a time.
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit WebServer(int port = 80) : _port { port } {}
+    ~WebServer() { close(); }
+
+    void begin();
+    void close();
+    void stop() { close(); }
+    /// @brief Serves a connection if one is waiting, without blocking otherwise.
+    void handleClient();
+
+    void on(const String& uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+    void on(const String& uri, HTTPMethod method, THandlerFunction fn);
+    void onNotFound(THandlerFunction fn) { _notFound = fn; }
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+
+    String arg(const String& name) const;
+    bool hasArg(const String& name) const;
+    String header(const String& name) const;
+    bool hasHeader(const String& name) const;
+    HTTPMethod method() const { return _method; }
+    const String& uri() const { return _uri; }
+    WiFiClient& client() { return _client; }
+
+    void send(int code, const char* contentType = nullptr, const String& content = String());
+    void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+
+    /// @brief Makes servers begun after this listen on the port given instead of their own, 0 for any free one.
+    static void listenOn(uint16_t port);
+    /// @brief The port the last server begun is listening on.
+    static uint16_t localPort();
+
+private:
+    struct Route {
+        String uri;
+        HTTPMethod method;
+        THandlerFunction fn;
+    };
+
+    // Reads and parses a request, false if it is malformed or the connection closes first.
+    bool readRequest(int connection);
+
+    int _port;
+    int _socket = -1;
+    int _connection = -1;
+    std::vector<Route> _routes;
+    THandlerFunction _notFound;
+    std::vector<String> _collect;
+
+    HTTPMethod _method = HTTP_GET;
+    String _uri;
+    std::vector<std::pair<String, String>> _args;
+    std::vector<std::pair<String, String>> _headers;
+    WiFiClient _client { IPAddress(127, 0, 0, 1) };
+};
+
+#endif //_DISCORD_ESP32A_NATIVE_WEBSERVER_H_
@@ -0,0 +1,115 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "WebSocketsClient.h"
+
+namespace ArduinoNative {
+    namespace {
+        WebSocketHost* webSocketHost = nullptr;
+    }
+
+    void setWebSocketHost(WebSocketHost* host) {
+        webSocketHost = host;
+    }
+}
+
+void WebSocketsClient::begin(const char* host, uint16_t port, const char* url, const char*) {
+    dropConnection();
+    _host = host;
+    _port = port;
+    _url = url;
+    _begun = true;
+    _lastConnectionFail = 0;
+}
+
+void WebSocketsClient::loop() {
+    if (!_begun) return;
+
+    if (!_connected) {
+        if (_lastConnectionFail != 0 && millis() - _lastConnectionFail < _reconnectInterval) return;
+        if (ArduinoNative::webSocketHost == nullptr || !ArduinoNative::webSocketHost->open(*this, _host, _port, _url)) {
+            // Like the library, a failed connection raises no event and is retried on a later loop().
+            _lastConnectionFail = millis();
+            if (_lastConnectionFail == 0) _lastConnectionFail = 1;
+            return;
+        }
+        _connected = true;
+        ++_generation;
+        std::string url(_url.c_str());
+        event(WStype_CONNECTED, reinterpret_cast<uint8_t*>(&url[0]), url.size());
+    }
+
+    unsigned long generation = _generation;
+    while (_connected && _generation == generation) {
+        Frame frame;
+        {
+            std::lock_guard<std::mutex> lock(_queueMtx);
+            if (_queue.empty() || static_cast<long>(millis() - _queue.front().due) < 0) return;
+            frame = std::move(_queue.front());
+            _queue.pop_front();
+        }
+        if (frame.close) {
+            dropConnection();
+            event(WStype_DISCONNECTED, nullptr, 0);
+            return;
+        }
+        // The payload is handed over writable and terminated, as the library does.
+        event(WStype_TEXT, reinterpret_cast<uint8_t*>(&frame.payload[0]), frame.payload.size());
+    }
+}
+
+bool WebSocketsClient::sendTXT(const char* payload, size_t length) {
+    if (!_connected) return false;
+    if (length == 0) length = strlen(payload);
+    ArduinoNative::webSocketHost->receive(*this, payload, length);
+    return true;
+}
+
+void WebSocketsClient::disconnect() {
+    bool wasConnected = _connected;
+    dropConnection();
+    if (wasConnected) {
+        if (ArduinoNative::webSocketHost) {
+            ArduinoNative::webSocketHost->closed(*this);
+        }
+        event(WStype_DISCONNECTED, nullptr, 0);
+    }
+}
+
+void WebSocketsClient::dropConnection() {
+    _connected = false;
+    ++_generation;
+    std::lock_guard<std::mutex> lock(_queueMtx);
+    _queue.clear();
+}
+
+void WebSocketsClient::push(const char* payload, size_t length, unsigned long delayMs) {
+    std::lock_guard<std::mutex> lock(_queueMtx);
+    _queue.push_back({ millis() + delayMs, false, std::string(payload, length) });
+}
+
+void WebSocketsClient::pushClose(unsigned long delayMs) {
+    std::lock_guard<std::mutex> lock(_queueMtx);
+    _queue.push_back({ millis() + delayMs, true, std::string() });
+}
+
+void WebSocketsClient::deliver(const char* payload, size_t length) {
+    if (!_connected) return;
+    std::string frame(payload, length);
+    event(WStype_TEXT, reinterpret_cast<uint8_t*>(&frame[0]), frame.size());
+}
@@ -0,0 +1,143 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "Arduino.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_WEBSOCKETSCLIENT_H_
+#define _DISCORD_ESP32A_NATIVE_WEBSOCKETSCLIENT_H_
+
+typedef enum {
+    WStype_ERROR,
+    WStype_DISCONNECTED,
+    WStype_CONNECTED,
+    WStype_TEXT,
+    WStype_BIN,
+    WStype_FRAGMENT_TEXT_START,
+    WStype_FRAGMENT_BIN_START,
+    WStype_FRAGMENT,
+    WStype_FRAGMENT_FIN,
+    WStype_PING,
+    WStype_PONG,
+} WStype_t;
+
+class WebSocketsClient;
+
+namespace ArduinoNative {
+    /// @brief What WebSocketsClient talks to in place of the network, such as a mock gateway.
+    /// The host answers by pushing frames to the client, which raises them from loop() like a socket would.
+    class WebSocketHost {
+    public:
+        virtual ~WebSocketHost() = default;
+
+        /// @brief Opens a connection, handshake included.
+        /// @return false if it was refused, which the client retries after its reconnect interval.
+        virtual bool open(WebSocketsClient& client, const String& host, uint16_t port, const String& url) = 0;
+        /// @brief A text frame sent by the client.
+        virtual void receive(WebSocketsClient& client, const char* payload, size_t length) = 0;
+        /// @brief The client closed the connection.
+        virtual void closed(WebSocketsClient& client) = 0;
+    };
+
+    /// @brief Routes every WebSocketsClient to a host, nullptr to refuse every connection.
+    void setWebSocketHost(WebSocketHost* host);
+}
+
+/// @brief links2004's WebSocketsClient, connecting to the WebSocketHost set with ArduinoNative::setWebSocketHost().
+/// Events are raised from loop() only, except DISCONNECTED, which disconnect() raises itself.
+class WebSocketsClient {
+public:
+    typedef std::function<void(WStype_t type, uint8_t* payload, size_t length)> WebSocketClientEvent;
+
+    void begin(const char* host, uint16_t port, const char* url = "/", const char* protocol = "arduino");
+    void begin(const String& host, uint16_t port, const String& url = "/", const String& protocol = "arduino") {
+        begin(host.c_str(), port, url.c_str(), protocol.c_str());
+    }
+    void beginSSL(const char* host, uint16_t port, const char* url = "/", const char* = "", const char* protocol = "arduino") {
+        begin(host, port, url, protocol);
+    }
+    void beginSSL(const String& host, uint16_t port, const String& url = "/", const String& = "", const String& protocol = "arduino") {
+        begin(host.c_str(), port, url.c_str(), protocol.c_str());
+    }
+
+    void onEvent(WebSocketClientEvent cbEvent) { _event = cbEvent; }
+    void loop();
+    bool isConnected() const { return _connected; }
+
+    bool sendTXT(const char* payload, size_t length = 0);
+    bool sendTXT(const uint8_t* payload, size_t length = 0) { return sendTXT(reinterpret_cast<const char*>(payload), length); }
+    bool sendTXT(const String& payload) { return sendTXT(payload.c_str(), payload.length()); }
+
+    void disconnect();
+
+    void enableHeartbeat(uint32_t pingInterval, uint32_t pongTimeout, uint8_t disconnectTimeoutCount) {
+        _pingInterval = pingInterval;
+        _pongTimeout = pongTimeout;
+        _pongMisses = disconnectTimeoutCount;
+    }
+    void disableHeartbeat() { _pingInterval = 0; }
+    void setReconnectInterval(unsigned long time) { _reconnectInterval = time; }
+
+    // The host's side.
+
+    /// @brief Queues a text frame, raised from the first loop() at least delayMs after this.
+    void push(const char* payload, size_t length, unsigned long delayMs = 0);
+    /// @brief Queues the host closing the connection, after the frames already queued.
+    void pushClose(unsigned long delayMs = 0);
+    /// @brief Raises a text frame right away, bypassing the queue.
+    void deliver(const char* payload, size_t length);
+    /// @brief The host the client is connected to, or trying to connect to.
+    const String& host() const { return _host; }
+
+private:
+    struct Frame {
+        unsigned long due;
+        bool close;
+        std::string payload;
+    };
+
+    void event(WStype_t type, uint8_t* payload, size_t length) {
+        if (_event) _event(type, payload, length);
+    }
+    // Drops the connection and whatever the host still had queued on it.
+    void dropConnection();
+
+    WebSocketClientEvent _event;
+    String _host;
+    uint16_t _port = 0;
+    String _url;
+    bool _begun = false;
+    bool _connected = false;
+    // Bumped on every connect and disconnect, so loop() stops raising frames of a connection a callback replaced.
+    unsigned long _generation = 0;
+    unsigned long _lastConnectionFail = 0;
+    unsigned long _reconnectInterval = 500;
+
+    uint32_t _pingInterval = 0;
+    uint32_t _pongTimeout = 0;
+    uint8_t _pongMisses = 0;
+
+    std::mutex _queueMtx;
+    std::deque<Frame> _queue;
+};
+
+#endif //_DISCORD_ESP32A_NATIVE_WEBSOCKETSCLIENT_H_
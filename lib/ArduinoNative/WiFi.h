@@ -0,0 +1,55 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "WiFiUdp.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_WIFI_H_
+#define _DISCORD_ESP32A_NATIVE_WIFI_H_
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL,
+    WL_SCAN_COMPLETED,
+    WL_CONNECTED,
+    WL_CONNECT_FAILED,
+    WL_CONNECTION_LOST,
+    WL_DISCONNECTED
+} wl_status_t;
+
+/// @brief A station that is always connected to a /24 network, unless a test takes it down.
+class WiFiClass {
+public:
+    wl_status_t status() const { return _status; }
+    bool isConnected() const { return _status == WL_CONNECTED; }
+    IPAddress localIP() const { return IPAddress(192, 168, 1, 50); }
+    IPAddress subnetMask() const { return IPAddress(255, 255, 255, 0); }
+    IPAddress gatewayIP() const { return IPAddress(192, 168, 1, 1); }
+
+    /// @brief Simulates losing or regaining the network.
+    void setStatus(wl_status_t status) { _status = status; }
+
+private:
+    wl_status_t _status = WL_CONNECTED;
+};
+
+extern WiFiClass WiFi;
+
+#endif //_DISCORD_ESP32A_NATIVE_WIFI_H_
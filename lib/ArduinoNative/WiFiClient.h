@@ -0,0 +1,85 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <string>
+
+#include "IPAddress.h"
+#include "Stream.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_WIFICLIENT_H_
+#define _DISCORD_ESP32A_NATIVE_WIFICLIENT_H_
+
+/// @brief The receiving end of a connection, over bytes handed to it by whatever stands in for the peer.
+/// Like a socket, it stays connected while there is data left to read after the peer has closed.
+class WiFiClient : public Stream {
+public:
+    WiFiClient() = default;
+    explicit WiFiClient(IPAddress remote) : _remote { remote } {}
+
+    bool connected() { return _open && (!_peerClosed || available() > 0); }
+    operator bool() { return connected(); }
+    void stop() {
+        _open = false;
+        _data.clear();
+        _at = 0;
+    }
+
+    int available() override { return static_cast<int>(_data.size() - _at); }
+    int read() override { return _at < _data.size() ? static_cast<uint8_t>(_data[_at++]) : -1; }
+    int read(uint8_t* buffer, size_t size) {
+        size_t count = std::min(size, _data.size() - _at);
+        _data.copy(reinterpret_cast<char*>(buffer), count, _at);
+        _at += count;
+        return static_cast<int>(count);
+    }
+    int peek() override { return _at < _data.size() ? static_cast<uint8_t>(_data[_at]) : -1; }
+
+    // Nothing is sent through the client itself, requests go to the peer whole.
+    size_t write(uint8_t) override { return 0; }
+
+    IPAddress remoteIP() const { return _remote; }
+
+    // The peer's side.
+
+    /// @brief Starts a connection with nothing received yet.
+    void open() {
+        stop();
+        _open = true;
+        _peerClosed = false;
+    }
+    /// @brief Makes bytes available to read.
+    void receive(const char* data, size_t length) {
+        if (_at == _data.size()) {
+            _data.clear();
+            _at = 0;
+        }
+        _data.append(data, length);
+    }
+    /// @brief Closes the connection once what has been received is read.
+    void closeByPeer() { _peerClosed = true; }
+
+private:
+    std::string _data;
+    size_t _at = 0;
+    bool _open = false;
+    bool _peerClosed = false;
+    IPAddress _remote;
+};
+
+#endif //_DISCORD_ESP32A_NATIVE_WIFICLIENT_H_
@@ -0,0 +1,141 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "WiFiUdp.h"
+
+namespace {
+    std::atomic<uint16_t> redirectPort { 0 };
+    std::atomic<uint32_t> lastAddress { 0 };
+    std::atomic<uint16_t> lastPortSent { 0 };
+
+    sockaddr_in addressOf(IPAddress ip, uint16_t port) {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        // IPAddress keeps its bytes in network order already.
+        address.sin_addr.s_addr = static_cast<uint32_t>(ip);
+        return address;
+    }
+}
+
+bool WiFiUDP::open() {
+    if (_socket >= 0) return true;
+    _socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_socket < 0) return false;
+    int on = 1;
+    setsockopt(_socket, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    return true;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    if (!open()) return 0;
+    sockaddr_in address = addressOf(IPAddress(0, 0, 0, 0), port);
+    return bind(_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+}
+
+void WiFiUDP::stop() {
+    if (_socket >= 0) {
+        close(_socket);
+        _socket = -1;
+    }
+    _packet.clear();
+    _received.clear();
+    _at = 0;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    _destination = ip;
+    _port = port;
+    _packet.clear();
+    return open();
+}
+
+int WiFiUDP::beginPacket(const char* host, uint16_t port) {
+    IPAddress ip;
+    if (!ip.fromString(host)) {
+        addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        addrinfo* found = nullptr;
+        if (getaddrinfo(host, nullptr, &hints, &found) != 0 || found == nullptr) return 0;
+        ip = IPAddress(reinterpret_cast<sockaddr_in*>(found->ai_addr)->sin_addr.s_addr);
+        freeaddrinfo(found);
+    }
+    return beginPacket(ip, port);
+}
+
+size_t WiFiUDP::write(uint8_t c) {
+    _packet += static_cast<char>(c);
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size) {
+    _packet.append(reinterpret_cast<const char*>(buffer), size);
+    return size;
+}
+
+int WiFiUDP::endPacket() {
+    if (_socket < 0) return 0;
+    uint16_t redirected = redirectPort.load(std::memory_order_relaxed);
+    sockaddr_in address = redirected ? addressOf(IPAddress(127, 0, 0, 1), redirected) : addressOf(_destination, _port);
+    ssize_t sent = sendto(_socket, _packet.data(), _packet.size(), 0, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    lastAddress.store(static_cast<uint32_t>(_destination), std::memory_order_relaxed);
+    lastPortSent.store(_port, std::memory_order_relaxed);
+    _packet.clear();
+    return sent >= 0;
+}
+
+int WiFiUDP::parsePacket() {
+    if (_socket < 0) return 0;
+    char buffer[1500];
+    sockaddr_in from = {};
+    socklen_t fromLength = sizeof(from);
+    ssize_t received = recvfrom(_socket, buffer, sizeof(buffer), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), &fromLength);
+    if (received <= 0) return 0;
+    _received.assign(buffer, received);
+    _at = 0;
+    _remoteIP = IPAddress(from.sin_addr.s_addr);
+    _remotePort = ntohs(from.sin_port);
+    return static_cast<int>(received);
+}
+
+int WiFiUDP::read(unsigned char* buffer, size_t length) {
+    size_t count = std::min(length, _received.size() - _at);
+    _received.copy(reinterpret_cast<char*>(buffer), count, _at);
+    _at += count;
+    return static_cast<int>(count);
+}
+
+void WiFiUDP::redirect(uint16_t port) {
+    redirectPort.store(port, std::memory_order_relaxed);
+}
+
+IPAddress WiFiUDP::lastDestination() {
+    return IPAddress(lastAddress.load(std::memory_order_relaxed));
+}
+
+uint16_t WiFiUDP::lastPort() {
+    return lastPortSent.load(std::memory_order_relaxed);
+}
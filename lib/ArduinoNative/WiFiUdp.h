@@ -0,0 +1,75 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <string>
+
+#include "Udp.h"
+
+#ifndef _DISCORD_ESP32A_NATIVE_WIFIUDP_H_
+#define _DISCORD_ESP32A_NATIVE_WIFIUDP_H_
+
+/// @brief UDP over a real socket. Packets can be redirected to a local port instead of where they were
+/// addressed, so a test can capture what would have gone out on the LAN.
+class WiFiUDP : public UDP {
+public:
+    WiFiUDP() = default;
+    // A copy gets a socket of its own.
+    WiFiUDP(const WiFiUDP&) : WiFiUDP() {}
+    WiFiUDP& operator=(const WiFiUDP&) {
+        stop();
+        return *this;
+    }
+    ~WiFiUDP() override { stop(); }
+
+    uint8_t begin(uint16_t port) override;
+    void stop() override;
+
+    int beginPacket(IPAddress ip, uint16_t port) override;
+    int beginPacket(const char* host, uint16_t port) override;
+    int endPacket() override;
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+
+    int parsePacket() override;
+    int available() override { return static_cast<int>(_received.size() - _at); }
+    int read() override { return _at < _received.size() ? static_cast<uint8_t>(_received[_at++]) : -1; }
+    int read(unsigned char* buffer, size_t length) override;
+    int peek() override { return _at < _received.size() ? static_cast<uint8_t>(_received[_at]) : -1; }
+    IPAddress remoteIP() override { return _remoteIP; }
+    uint16_t remotePort() override { return _remotePort; }
+
+    /// @brief Sends every packet from now on to 127.0.0.1 on this port instead, 0 to send them as addressed.
+    static void redirect(uint16_t port);
+    /// @brief Where the last packet sent was addressed, before any redirect.
+    static IPAddress lastDestination();
+    static uint16_t lastPort();
+
+private:
+    bool open();
+
+    int _socket = -1;
+    IPAddress _destination;
+    uint16_t _port = 0;
+    std::string _packet;
+    std::string _received;
+    size_t _at = 0;
+    IPAddress _remoteIP;
+    uint16_t _remotePort = 0;
+};
+
+#endif //_DISCORD_ESP32A_NATIVE_WIFIUDP_H_
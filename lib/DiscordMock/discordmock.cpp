@@ -0,0 +1,497 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/time.h>
+
+#include <ArduinoJson.h>
+#include <sodium.h>
+
+#include "discordmock.h"
+
+namespace Discord {
+    namespace Mock {
+        const char* const BOT_TOKEN = "mock-bot-token";
+        const char* const GATEWAY_HOST = "gateway.discord.gg";
+        const char* const RESUME_HOST = "gateway-us-east1-b.discord.gg";
+
+        namespace {
+            const char* API = "/api/v10";
+            // Snowflakes count milliseconds from the first second of 2015.
+            const uint64_t EPOCH = 1420070400000ULL;
+
+            struct KeyPair {
+                unsigned char publicKey[crypto_sign_PUBLICKEYBYTES];
+                unsigned char secretKey[crypto_sign_SECRETKEYBYTES];
+                char publicKeyHex[2 * crypto_sign_PUBLICKEYBYTES + 1];
+
+                KeyPair() {
+                    // Seeded, so the key stays the same from run to run.
+                    unsigned char seed[crypto_sign_SEEDBYTES];
+                    memset(seed, 0x2a, sizeof(seed));
+                    sodium_init();
+                    crypto_sign_seed_keypair(publicKey, secretKey, seed);
+                    sodium_bin2hex(publicKeyHex, sizeof(publicKeyHex), publicKey, sizeof(publicKey));
+                }
+            };
+
+            const KeyPair& keys() {
+                static KeyPair instance;
+                return instance;
+            }
+
+            String id(uint64_t value) {
+                char text[24];
+                snprintf(text, sizeof(text), "\"%llu\"", static_cast<unsigned long long>(value));
+                return text;
+            }
+
+            const char* reason(int status) {
+                switch (status) {
+                    case 200: return "OK";
+                    case 201: return "Created";
+                    case 204: return "No Content";
+                    case 400: return "Bad Request";
+                    case 401: return "Unauthorized";
+                    case 404: return "Not Found";
+                    case 429: return "Too Many Requests";
+                    case 500: return "Internal Server Error";
+                    case 502: return "Bad Gateway";
+                    case 503: return "Service Unavailable";
+                    default: return "";
+                }
+            }
+
+            // Close codes after which the session cannot be resumed.
+            bool isFatal(uint16_t code) {
+                return code == 4004 || code == 4007 || code == 4009 || (code >= 4010 && code <= 4014);
+            }
+        }
+
+        const char* publicKey() {
+            return keys().publicKeyHex;
+        }
+
+        String sign(const char* timestamp, const String& body) {
+            String message(timestamp);
+            message += body;
+            unsigned char signature[crypto_sign_BYTES];
+            crypto_sign_detached(signature, nullptr, reinterpret_cast<const unsigned char*>(message.c_str()),
+                message.length(), keys().secretKey);
+            char hex[2 * crypto_sign_BYTES + 1];
+            sodium_bin2hex(hex, sizeof(hex), signature, sizeof(signature));
+            return hex;
+        }
+
+        String interactionPayload(uint64_t interactionId, const char* token, int type, const char* name, uint64_t userId,
+            const char* options) {
+            String payload("{\"id\":");
+            payload += id(interactionId);
+            payload += ",\"application_id\":";
+            payload += id(APPLICATION_ID);
+            payload += ",\"type\":";
+            payload += String(type);
+            payload += ",\"token\":\"";
+            payload += token;
+            payload += "\",\"version\":1,\"guild_id\":";
+            payload += id(GUILD_ID);
+            payload += ",\"channel_id\":";
+            payload += id(CHANNEL_ID);
+            payload += ",\"app_permissions\":\"2147483648\",\"locale\":\"en-GB\",\"guild_locale\":\"en-US\"";
+            payload += ",\"member\":{\"user\":{\"id\":";
+            payload += id(userId);
+            payload += ",\"username\":\"mock-user\",\"global_name\":\"Mock User\",\"discriminator\":\"0\"}";
+            payload += ",\"roles\":[],\"permissions\":\"2147483648\",\"joined_at\":\"2023-01-01T00:00:00.000000+00:00\"}";
+            payload += ",\"data\":{\"id\":";
+            payload += id(APPLICATION_ID + 100);
+            payload += ",\"name\":\"";
+            payload += name;
+            payload += "\",\"type\":1,\"options\":";
+            payload += options;
+            payload += "}}";
+            return payload;
+        }
+
+        Server& server() {
+            // Never destroyed, the bot's clients are globals that still close their connections on exit.
+            static Server* instance = nullptr;
+            if (instance == nullptr) {
+                instance = new Server();
+                ArduinoNative::setHttpHost(instance);
+                ArduinoNative::setWebSocketHost(instance);
+            }
+            return *instance;
+        }
+
+        bool runUntil(const std::function<void()>& step, const std::function<bool()>& done,
+            unsigned long timeout, unsigned long tick) {
+            unsigned long start = millis();
+            while (!done()) {
+                if (millis() - start > timeout) return false;
+                step();
+                ArduinoNative::advanceClock(tick);
+            }
+            return true;
+        }
+
+        void Server::reset() {
+            config = Config();
+            if (_client) {
+                _client->pushClose();
+                _client = nullptr;
+            }
+            _sessionId = "";
+            _sequence = 0;
+            _history.clear();
+            connects = identifies = resumes = heartbeats = 0;
+            lastCloseCode = 0;
+            lastHost = "";
+            lastIdentify = "";
+            lastIdentifyAt = 0;
+
+            _connections.clear();
+            _failNext = 0;
+            _dropNext = 0;
+            connectionsOpened = 0;
+            requests.clear();
+            callbacks.clear();
+            commands.clear();
+            _interactions.clear();
+            _lastInteraction = 0;
+        }
+
+        void Server::failNext(unsigned int count, int status) {
+            _failNext = count;
+            _failStatus = status;
+        }
+
+        void Server::dropNext(unsigned int count) {
+            _dropNext = count;
+        }
+
+        // Gateway
+
+        void Server::send(const String& frame) {
+            if (_client) {
+                _client->push(frame.c_str(), frame.length(), config.gatewayLatency);
+            }
+        }
+
+        void Server::dispatch(const char* name, const String& data) {
+            String frame("{\"op\":0,\"s\":");
+            frame += String(++_sequence);
+            frame += ",\"t\":\"";
+            frame += name;
+            frame += "\",\"d\":";
+            frame += data;
+            frame += "}";
+            _history.push_back(frame);
+            send(frame);
+        }
+
+        String Server::newInteraction(const char* name, uint64_t userId, const char* options, int type) {
+            std::lock_guard<std::recursive_mutex> lock(_restMtx);
+            struct timeval now;
+            gettimeofday(&now, nullptr);
+            uint64_t ms = static_cast<uint64_t>(now.tv_sec) * 1000 + now.tv_usec / 1000;
+            // Unique even when created within the same millisecond.
+            uint64_t snowflake = std::max((ms - EPOCH) << 22, _lastSnowflake + 1);
+            _lastSnowflake = snowflake;
+            _lastInteraction = snowflake;
+
+            String token("mock-interaction-token-");
+            token += String(static_cast<unsigned long long>(snowflake));
+            _interactions[snowflake] = { token, false };
+            return interactionPayload(snowflake, token.c_str(), type, name, userId, options);
+        }
+
+        uint64_t Server::interaction(const char* name, uint64_t userId, const char* options, int type) {
+            dispatch("INTERACTION_CREATE", newInteraction(name, userId, options, type));
+            return _lastInteraction;
+        }
+
+        void Server::reconnect() {
+            send("{\"op\":7,\"d\":null}");
+        }
+
+        void Server::invalidSession(bool resumable) {
+            send(resumable ? "{\"op\":9,\"d\":true}" : "{\"op\":9,\"d\":false}");
+            if (!resumable) {
+                _sessionId = "";
+                _history.clear();
+            }
+        }
+
+        void Server::disconnect(uint16_t code) {
+            lastCloseCode = code;
+            if (isFatal(code)) {
+                _sessionId = "";
+                _history.clear();
+            }
+            if (_client) {
+                _client->pushClose(config.gatewayLatency);
+                _client = nullptr;
+            }
+        }
+
+        void Server::deliver(const String& frame) {
+            if (_client) {
+                _client->deliver(frame.c_str(), frame.length());
+            }
+        }
+
+        void Server::newSession() {
+            _sessionId = "mock-session-";
+            _sessionId += String(++_sessions);
+            _sequence = 0;
+            _history.clear();
+
+            String ready("{\"v\":10,\"user\":{\"id\":");
+            ready += id(APPLICATION_ID);
+            ready += ",\"username\":\"mock-bot\",\"discriminator\":\"0\",\"bot\":true},\"guilds\":[{\"id\":";
+            ready += id(GUILD_ID);
+            ready += ",\"unavailable\":true}],\"session_id\":\"";
+            ready += _sessionId;
+            ready += "\",\"resume_gateway_url\":\"wss://";
+            ready += RESUME_HOST;
+            ready += "\",\"shard\":[0,1],\"application\":{\"id\":";
+            ready += id(APPLICATION_ID);
+            ready += ",\"flags\":0}}";
+            dispatch("READY", ready);
+        }
+
+        bool Server::open(WebSocketsClient& client, const String& host, uint16_t, const String&) {
+            if (config.refuseConnections) return false;
+            delay(config.handshakeLatency);
+            ++connects;
+            lastHost = host;
+            _client = &client;
+
+            String hello("{\"op\":10,\"s\":null,\"t\":null,\"d\":{\"heartbeat_interval\":");
+            hello += String(config.heartbeatInterval);
+            hello += "}}";
+            send(hello);
+            return true;
+        }
+
+        void Server::receive(WebSocketsClient& client, const char* payload, size_t length) {
+            // Frames still in flight on a connection the server has closed.
+            if (&client != _client || config.ignoreClient) return;
+
+            DynamicJsonDocument doc(1024);
+            if (deserializeJson(doc, payload, length)) {
+                disconnect(4002);
+                return;
+            }
+
+            switch (doc["op"].as<int>()) {
+                case 1:
+                    ++heartbeats;
+                    if (config.ackHeartbeats) {
+                        send("{\"op\":11}");
+                    }
+                    break;
+                case 2:
+                    ++identifies;
+                    lastIdentify = String(payload, length);
+                    lastIdentifyAt = millis();
+                    if (strcmp(doc["d"]["token"] | "", BOT_TOKEN) != 0) {
+                        disconnect(4004);
+                        return;
+                    }
+                    newSession();
+                    break;
+                case 6: {
+                    ++resumes;
+                    if (_sessionId.isEmpty() || _sessionId != doc["d"]["session_id"].as<const char*>() ||
+                        strcmp(doc["d"]["token"] | "", BOT_TOKEN) != 0) {
+                        send("{\"op\":9,\"d\":false}");
+                        return;
+                    }
+                    // Everything the client missed, then RESUMED.
+                    unsigned int seen = doc["d"]["seq"] | 0u;
+                    for (size_t i = seen; i < _history.size(); ++i) {
+                        send(_history[i]);
+                    }
+                    dispatch("RESUMED", "{}");
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+
+        void Server::closed(WebSocketsClient& client) {
+            if (&client == _client) {
+                _client = nullptr;
+            }
+        }
+
+        // REST
+
+        uint32_t Server::open(const String&, uint16_t) {
+            if (config.refuseConnections) return 0;
+            delay(config.handshakeLatency);
+            std::lock_guard<std::recursive_mutex> lock(_restMtx);
+            ++connectionsOpened;
+            _connections[++_nextConnection] = { millis(), 0 };
+            return _nextConnection;
+        }
+
+        bool Server::alive(uint32_t connection) {
+            std::lock_guard<std::recursive_mutex> lock(_restMtx);
+            auto found = _connections.find(connection);
+            if (found == _connections.end()) return false;
+            if (config.idleTimeout > 0 && millis() - found->second.lastUsed >= config.idleTimeout) {
+                _connections.erase(found);
+                return false;
+            }
+            return true;
+        }
+
+        void Server::close(uint32_t connection) {
+            std::lock_guard<std::recursive_mutex> lock(_restMtx);
+            _connections.erase(connection);
+        }
+
+        bool Server::handle(uint32_t connection, const ArduinoNative::HttpRequest& request, String& response) {
+            {
+                std::lock_guard<std::recursive_mutex> lock(_restMtx);
+                if (!alive(connection)) return false;
+                if (_dropNext > 0) {
+                    --_dropNext;
+                    _connections.erase(connection);
+                    return false;
+                }
+            }
+            delay(config.restLatency);
+
+            std::lock_guard<std::recursive_mutex> lock(_restMtx);
+            Connection& state = _connections[connection];
+            bool reused = state.served > 0;
+            String body;
+            int status;
+            if (_failNext > 0) {
+                --_failNext;
+                status = _failStatus;
+                body = "{\"message\":\"Mock failure\",\"code\":0}";
+            }
+            else {
+                status = route(request, body);
+            }
+            requests.push_back({ request.method, request.path, request.body, status, reused });
+
+            bool close = ++state.served >= config.keepAliveRequests || request.header("Connection").equalsIgnoreCase("close");
+            state.lastUsed = millis();
+
+            response = "HTTP/1.1 ";
+            response += String(status);
+            response += " ";
+            response += reason(status);
+            response += "\r\n";
+            if (!body.isEmpty()) {
+                response += "Content-Type: application/json\r\n";
+            }
+            if (config.chunked && !body.isEmpty()) {
+                char size[12];
+                snprintf(size, sizeof(size), "%x", static_cast<unsigned>(body.length()));
+                response += "Transfer-Encoding: chunked\r\n";
+                response += close ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+                response += size;
+                response += "\r\n";
+                response += body;
+                response += "\r\n0\r\n\r\n";
+            }
+            else {
+                response += "Content-Length: ";
+                response += String(static_cast<unsigned>(body.length()));
+                response += close ? "\r\nConnection: close\r\n\r\n" : "\r\nConnection: keep-alive\r\n\r\n";
+                response += body;
+            }
+            if (close) {
+                _connections.erase(connection);
+            }
+            return true;
+        }
+
+        int Server::route(const ArduinoNative::HttpRequest& request, String& body) {
+            if (!request.path.startsWith(API)) {
+                body = "{\"message\":\"404: Not Found\",\"code\":0}";
+                return 404;
+            }
+            String path = request.path.substring(strlen(API));
+            const String& method = request.method;
+
+            if (method == "GET" && path == "/gateway") {
+                body = String("{\"url\":\"wss://") + GATEWAY_HOST + "\"}";
+                return 200;
+            }
+            if (path.startsWith("/interactions/") && path.endsWith("/callback")) {
+                // Authorised by the interaction token in the path.
+                return method == "POST" ? callback(path, request.body, body) : 404;
+            }
+
+            String authorization("Bot ");
+            authorization += BOT_TOKEN;
+            if (request.header("Authorization") != authorization) {
+                body = "{\"message\":\"401: Unauthorized\",\"code\":0}";
+                return 401;
+            }
+
+            if (method == "GET" && path == "/gateway/bot") {
+                body = String("{\"url\":\"wss://") + GATEWAY_HOST + "\",\"shards\":1,\"session_start_limit\":"
+                    "{\"total\":1000,\"remaining\":999,\"reset_after\":14400000,\"max_concurrency\":1}}";
+                return 200;
+            }
+            if (method == "GET" && path == "/oauth2/applications/@me") {
+                body = String("{\"id\":") + id(APPLICATION_ID) + ",\"name\":\"mock-bot\",\"bot_public\":false}";
+                return 200;
+            }
+            String commandsPath = String("/applications/") + String(static_cast<unsigned long long>(APPLICATION_ID));
+            if (path.startsWith(commandsPath) && path.indexOf("/commands") >= 0) {
+                if (method == "POST" && path.endsWith("/commands")) {
+                    commands.push_back(request.body);
+                    body = String("{\"id\":") + id(APPLICATION_ID + 1000 + commands.size()) + "}";
+                    return 201;
+                }
+                if (method == "DELETE") return 204;
+            }
+            body = "{\"message\":\"404: Not Found\",\"code\":0}";
+            return 404;
+        }
+
+        int Server::callback(const String& path, const String& requestBody, String& body) {
+            // /interactions/<id>/<token>/callback
+            int idEnd = path.indexOf('/', strlen("/interactions/"));
+            uint64_t interactionId = strtoull(path.c_str() + strlen("/interactions/"), nullptr, 10);
+            String token = path.substring(idEnd + 1, path.length() - strlen("/callback"));
+
+            auto found = _interactions.find(interactionId);
+            if (idEnd < 0 || found == _interactions.end() || found->second.token != token) {
+                body = "{\"message\":\"Unknown interaction\",\"code\":10062}";
+                return 404;
+            }
+            if (found->second.answered) {
+                body = "{\"message\":\"Interaction has already been acknowledged.\",\"code\":40060}";
+                return 400;
+            }
+            found->second.answered = true;
+            callbacks.push_back({ interactionId, requestBody, micros() });
+            return 204;
+        }
+    }
+}
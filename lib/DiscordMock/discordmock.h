@@ -0,0 +1,204 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <WebSocketsClient.h>
+
+#ifndef _DISCORD_ESP32A_MOCK_H_
+#define _DISCORD_ESP32A_MOCK_H_
+
+namespace Discord {
+    namespace Mock {
+        extern const char* const BOT_TOKEN;
+        extern const char* const GATEWAY_HOST;
+        extern const char* const RESUME_HOST;
+        constexpr uint64_t APPLICATION_ID = 1100000000000000001ULL;
+        constexpr uint64_t OWNER_ID = 1100000000000000002ULL;
+        constexpr uint64_t GUILD_ID = 1100000000000000003ULL;
+        constexpr uint64_t CHANNEL_ID = 1100000000000000004ULL;
+
+        /// @brief The mock application's Ed25519 public key, as hex for the bot's configuration.
+        const char* publicKey();
+        /// @brief Signs an interaction POSTed to the endpoint, as hex for the X-Signature-Ed25519 header.
+        String sign(const char* timestamp, const String& body);
+
+        /// @brief The INTERACTION_CREATE data of a command, as Discord sends it over the gateway or to the endpoint.
+        /// @param options JSON array of the options given.
+        String interactionPayload(uint64_t id, const char* token, int type, const char* name, uint64_t userId,
+            const char* options);
+
+        struct Config {
+            // ms before each frame sent by the gateway is received.
+            unsigned long gatewayLatency = 0;
+            // ms each REST request waits for its response.
+            unsigned long restLatency = 0;
+            // ms to open a connection, TLS handshake included, to the gateway or the REST API.
+            unsigned long handshakeLatency = 0;
+            unsigned long heartbeatInterval = 41250;
+            bool ackHeartbeats = true;
+            // Requests served on a REST connection before it is closed, as load balancers do.
+            unsigned int keepAliveRequests = 100;
+            // ms a REST connection may sit idle before it is closed, 0 to keep it forever.
+            unsigned long idleTimeout = 0;
+            // REST bodies are sent chunked, without Content-Length.
+            bool chunked = false;
+            // Refuses every connection, as when the network is up but Discord cannot be reached.
+            bool refuseConnections = false;
+            // Ignores every frame the client sends, so that only the client's side of an exchange is timed.
+            bool ignoreClient = false;
+        };
+
+        struct Request {
+            String method;
+            String path;
+            String body;
+            int status;
+            // Whether the request was sent on a connection that had served one before.
+            bool reused;
+        };
+
+        struct Callback {
+            uint64_t interactionId;
+            String body;
+            // micros() when the request was answered.
+            unsigned long completedUs;
+        };
+
+        /// @brief Discord's gateway and REST API, as one host for both WebSocketsClient and HTTPClient.
+        /// Everything happens on the thread that drives the client, so tests read the state below directly. REST
+        /// requests from tasks on threads of their own, see ArduinoNative::runTasksOnThreads(), are served under a lock,
+        /// and their state is for reading once those tasks are done.
+        class Server : public ArduinoNative::HttpHost, public ArduinoNative::WebSocketHost {
+        public:
+            Config config;
+
+            /// @brief Forgets every session, connection, interaction and request, and restores the default config.
+            void reset();
+
+            /// @brief Answers the next REST requests with an error status instead.
+            void failNext(unsigned int count, int status = 500);
+            /// @brief Drops the connection of the next REST requests without answering them.
+            void dropNext(unsigned int count);
+
+            // Gateway.
+
+            bool connected() const { return _client != nullptr; }
+            /// @brief Sends a dispatch event, numbered in the session and kept for replay on resume.
+            void dispatch(const char* name, const String& data);
+            /// @brief Registers an interaction, for dispatching or POSTing to the endpoint.
+            /// @return Its INTERACTION_CREATE data. The id is in lastInteraction().
+            String newInteraction(const char* name, uint64_t userId = OWNER_ID, const char* options = "[]", int type = 2);
+            /// @brief Dispatches a new interaction.
+            /// @return Its id.
+            uint64_t interaction(const char* name, uint64_t userId = OWNER_ID, const char* options = "[]", int type = 2);
+            uint64_t lastInteraction() const { return _lastInteraction; }
+            /// @brief Asks the client to reconnect and resume, opcode 7.
+            void reconnect();
+            /// @brief Invalidates the session, opcode 9. Unless resumable, it is also forgotten.
+            void invalidSession(bool resumable);
+            /// @brief Closes the connection with a close code. Codes such as 4004 and 4009 also forget the session.
+            void disconnect(uint16_t code);
+            /// @brief Raises a frame on the client right away, e.g. one that is not valid JSON.
+            void deliver(const String& frame);
+
+            unsigned int connects = 0;
+            unsigned int identifies = 0;
+            unsigned int resumes = 0;
+            unsigned int heartbeats = 0;
+            uint16_t lastCloseCode = 0;
+            // Host the client last connected to.
+            String lastHost;
+            // The last IDENTIFY frame, as the client sent it, and millis() when it arrived.
+            String lastIdentify;
+            unsigned long lastIdentifyAt = 0;
+
+            // REST.
+
+            unsigned int connectionsOpened = 0;
+            std::vector<Request> requests;
+            std::vector<Callback> callbacks;
+            // Bodies of the commands registered.
+            std::vector<String> commands;
+
+            // HttpHost
+            uint32_t open(const String& host, uint16_t port) override;
+            bool alive(uint32_t connection) override;
+            void close(uint32_t connection) override;
+            bool handle(uint32_t connection, const ArduinoNative::HttpRequest& request, String& response) override;
+
+            // WebSocketHost
+            bool open(WebSocketsClient& client, const String& host, uint16_t port, const String& url) override;
+            void receive(WebSocketsClient& client, const char* payload, size_t length) override;
+            void closed(WebSocketsClient& client) override;
+
+        private:
+            struct Connection {
+                unsigned long lastUsed;
+                unsigned int served;
+            };
+
+            struct Interaction {
+                String token;
+                bool answered;
+            };
+
+            void send(const String& frame);
+            void newSession();
+            // Routes a REST request, returning the status and filling in the body.
+            int route(const ArduinoNative::HttpRequest& request, String& body);
+            int callback(const String& path, const String& requestBody, String& body);
+
+            // Held while serving REST requests and creating interactions, which tasks may do alongside the loop.
+            std::recursive_mutex _restMtx;
+
+            WebSocketsClient* _client = nullptr;
+            String _sessionId;
+            unsigned int _sessions = 0;
+            unsigned int _sequence = 0;
+            // Dispatches of the current session, replayed on resume.
+            std::vector<String> _history;
+
+            std::map<uint32_t, Connection> _connections;
+            uint32_t _nextConnection = 0;
+            unsigned int _failNext = 0;
+            int _failStatus = 500;
+            unsigned int _dropNext = 0;
+
+            std::map<uint64_t, Interaction> _interactions;
+            uint64_t _lastInteraction = 0;
+            uint64_t _lastSnowflake = 0;
+        };
+
+        /// @brief The server every client talks to, routed to by the first call.
+        Server& server();
+
+        /// @brief Calls step, e.g. the sketch's loop(), until done holds or the timeout passes.
+        /// The clock is moved on by tick ms on every step, so waits such as reconnect backoffs pass at once.
+        /// @return Whether done held in time.
+        bool runUntil(const std::function<void()>& step, const std::function<bool()>& done,
+            unsigned long timeout = 60000, unsigned long tick = 10);
+    }
+}
+
+#endif //_DISCORD_ESP32A_MOCK_H_
@@ -0,0 +1,58 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <discordmock.h>
+
+#ifndef PRIVATECONFIG_H
+#define PRIVATECONFIG_H
+
+// privateconfig.h for the native tests, pointing the bot at the mock server. Tests that need the interactions
+// endpoint or LAN wakes set publicKey and lanToken before calling setup().
+
+//Default wifi parameters
+const char* wifiSSID = "native";
+const char* wifiPassword = "";
+
+//MAC address of the target device
+const char* macAddress = "AA:BB:CC:DD:EE:01";
+
+//Targets selectable by name in /wake. The first one is the default, and the one the button wakes.
+struct WakeTarget {
+    const char* name;
+    const char* macAddress;
+};
+WakeTarget wakeTargets[] = {
+    { "main", macAddress },
+    { "nas", "AA:BB:CC:DD:EE:02" },
+};
+
+//Secret bot token
+const char* botToken = Discord::Mock::BOT_TOKEN;
+
+//Public key from the developer portal. Empty, so interactions arrive over the gateway.
+const char* publicKey = "";
+
+//Token for waking targets from the LAN. Empty, so the endpoint is off.
+const char* lanToken = "";
+
+//Bot owner's user IDs
+uint64_t botOwnerIds[] = {
+    Discord::Mock::OWNER_ID,
+};
+
+#endif //PRIVATECONFIG_H
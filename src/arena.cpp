@@ -0,0 +1,102 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <arena.h>
+
+namespace Discord {
+    Arena::Arena(size_t capacity) {
+        _buffer = static_cast<uint8_t*>(malloc(capacity));
+        _capacity = _buffer ? capacity : 0;
+    }
+
+    Arena::~Arena() {
+        free(_buffer);
+    }
+
+    size_t Arena::align(size_t size) {
+        return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    void* Arena::allocate(size_t size) {
+        size_t needed = HEADER_SIZE + align(size);
+        if (needed < size || needed > _capacity - _top) {
+            ++_failures;
+            return nullptr;
+        }
+
+        Header* header = reinterpret_cast<Header*>(_buffer + _top);
+        header->previous = _last;
+        header->size = size;
+        _last = _top;
+        _top += needed;
+        if (_top > _highWater) {
+            _highWater = _top;
+        }
+        return _buffer + _last + HEADER_SIZE;
+    }
+
+    void Arena::deallocate(void* block) {
+        if (block == nullptr) return;
+
+        Header* header = headerOf(block);
+        uint32_t offset = reinterpret_cast<uint8_t*>(header) - _buffer;
+        if (offset != _last) {
+            // Freed out of order, the space comes back when the blocks above it are freed or on reset().
+            header->size = FREED;
+            return;
+        }
+
+        // Unwind this block, then any blocks below it that were already freed out of order.
+        do {
+            _top = _last;
+            _last = reinterpret_cast<Header*>(_buffer + _top)->previous;
+        } while (_last != NONE && reinterpret_cast<Header*>(_buffer + _last)->size == FREED);
+    }
+
+    void* Arena::reallocate(void* block, size_t size) {
+        if (block == nullptr) return allocate(size);
+
+        Header* header = headerOf(block);
+        uint32_t offset = reinterpret_cast<uint8_t*>(header) - _buffer;
+        if (offset == _last) {
+            // The topmost block grows or shrinks in place.
+            size_t end = offset + HEADER_SIZE + align(size);
+            if (end < offset || end > _capacity) {
+                ++_failures;
+                return nullptr;
+            }
+            header->size = size;
+            _top = end;
+            if (_top > _highWater) {
+                _highWater = _top;
+            }
+            return block;
+        }
+
+        void* moved = allocate(size);
+        if (moved == nullptr) return nullptr;
+        memcpy(moved, block, header->size < size ? header->size : size);
+        deallocate(block);
+        return moved;
+    }
+
+    void Arena::reset() {
+        _top = 0;
+        _last = NONE;
+    }
+}
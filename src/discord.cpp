@@ -21,51 +21,429 @@
 #define DISCORD_MESSAGE_PREFIX "[DISCORD] "
 
 namespace Discord {
+#ifdef _DISCORD_CLIENT_DEBUG
+    namespace {
+        // Reports the cost of one gateway frame when parseMessage() returns.
+        // Parse time excludes the pretty-print below; dispatch time includes the callbacks and any responses sent.
+        struct FrameProfile {
+            FrameProfile(const JsonDocument& doc, size_t length, unsigned long start, uint32_t heapBefore) :
+                doc { doc }, length { length }, start { start }, parsed { micros() }, heapBefore { heapBefore },
+                heapAfterParse { freeHeap() } {}
 
-    Bot::Bot(const char* botToken, bool enableRateLimit) :
-        _botToken { botToken }, _rateLimit { enableRateLimit } {}
+            ~FrameProfile() {
+                unsigned long end = micros();
+                DISCORD_LOGD("[PROFILE] %s (op %d): %ub frame, parse (us): %lu, dispatch (us): %lu, "
+                    "document: %u/%ub, heap allocated: %ldb",
+                    doc["t"].is<const char*>() ? doc["t"].as<const char*>() : "-", doc["op"].as<int>(),
+                    static_cast<unsigned>(length), parsed - start, end - parsed,
+                    static_cast<unsigned>(doc.memoryUsage()), static_cast<unsigned>(doc.capacity()),
+                    static_cast<long>(heapBefore) - static_cast<long>(heapAfterParse));
+            }
 
-    void Bot::login(unsigned int intents) {
-        _https.begin(DISCORD_HOST, nullptr);
-        //Establish a connection with the Gateway after fetching and caching a WSS URL using the Get Gateway endpoint.
-        if (_gatewayURL.isEmpty()) {
-            StaticJsonDocument<64> doc;
-            if (sendRest<64>(_https, "GET", DISCORD_API_URI "/gateway", "", "", &doc)) {
-                _gatewayURL = doc["url"].as<const char*>() + 6; // Remove the 'wss://' prefix
-                Serial.print(DISCORD_MESSAGE_PREFIX "Gateway URL set to ");
-                Serial.println(_gatewayURL);
+            const JsonDocument& doc;
+            size_t length;
+            unsigned long start;
+            unsigned long parsed;
+            uint32_t heapBefore;
+            uint32_t heapAfterParse;
+        };
+    }
+#endif
+
+    namespace {
+        using Event = Bot::Event;
+        using namespace Intents;
+
+        // Indexed by Event. Opcodes have no name and are always delivered.
+        constexpr Bot::EventDescriptor EVENTS[] = {
+            { Event::Dispatch, nullptr, 0 },
+            { Event::Heartbeat, nullptr, 0 },
+            { Event::Identify, nullptr, 0 },
+            { Event::PresenceUpdate, nullptr, 0 },
+            { Event::VoiceStateUpdate, nullptr, 0 },
+            { static_cast<Event>(5), nullptr, 0 },
+            { Event::Resume, nullptr, 0 },
+            { Event::Reconnect, nullptr, 0 },
+            { Event::RequestGuildMembers, nullptr, 0 },
+            { Event::InvalidSession, nullptr, 0 },
+            { Event::Hello, nullptr, 0 },
+            { Event::HeartbeatAck, nullptr, 0 },
+            { Event::Ready, "READY", 0 },
+            { Event::Resumed, "RESUMED", 0 },
+            { Event::ApplicationCommandPermissionsUpdate, "APPLICATION_COMMAND_PERMISSIONS_UPDATE", 0 },
+            { Event::AutoModerationRuleCreate, "AUTO_MODERATION_RULE_CREATE", AUTO_MODERATION_CONFIGURATION },
+            { Event::AutoModerationRuleUpdate, "AUTO_MODERATION_RULE_UPDATE", AUTO_MODERATION_CONFIGURATION },
+            { Event::AutoModerationRuleDelete, "AUTO_MODERATION_RULE_DELETE", AUTO_MODERATION_CONFIGURATION },
+            { Event::AutoModerationRuleExecution, "AUTO_MODERATION_ACTION_EXECUTION", AUTO_MODERATION_EXECUTION },
+            { Event::ChannelCreate, "CHANNEL_CREATE", GUILDS },
+            { Event::ChannelUpdate, "CHANNEL_UPDATE", GUILDS },
+            { Event::ChannelDelete, "CHANNEL_DELETE", GUILDS },
+            { Event::ThreadCreate, "THREAD_CREATE", GUILDS },
+            { Event::ThreadUpdate, "THREAD_UPDATE", GUILDS },
+            { Event::ThreadDelete, "THREAD_DELETE", GUILDS },
+            { Event::ThreadListSync, "THREAD_LIST_SYNC", GUILDS },
+            { Event::ThreadMemberUpdate, "THREAD_MEMBER_UPDATE", GUILDS },
+            { Event::ThreadMembersUpdate, "THREAD_MEMBERS_UPDATE", GUILDS | GUILD_MEMBERS },
+            { Event::ChannelPinsUpdate, "CHANNEL_PINS_UPDATE", GUILDS | DIRECT_MESSAGES },
+            { Event::GuildCreate, "GUILD_CREATE", GUILDS },
+            { Event::GuildUpdate, "GUILD_UPDATE", GUILDS },
+            { Event::GuildDelete, "GUILD_DELETE", GUILDS },
+            { Event::GuildAuditLogEntryCreate, "GUILD_AUDIT_LOG_ENTRY_CREATE", GUILD_MODERATION },
+            { Event::GuildBanAdd, "GUILD_BAN_ADD", GUILD_MODERATION },
+            { Event::GuildBanRemove, "GUILD_BAN_REMOVE", GUILD_MODERATION },
+            { Event::GuildEmojisUpdate, "GUILD_EMOJIS_UPDATE", GUILD_EMOJIS_AND_STICKERS },
+            { Event::GuildStickersUpdate, "GUILD_STICKERS_UPDATE", GUILD_EMOJIS_AND_STICKERS },
+            { Event::GuildIntegrationsUpdate, "GUILD_INTEGRATIONS_UPDATE", GUILD_INTEGRATIONS },
+            { Event::GuildMemberAdd, "GUILD_MEMBER_ADD", GUILD_MEMBERS },
+            { Event::GuildMemberRemove, "GUILD_MEMBER_REMOVE", GUILD_MEMBERS },
+            { Event::GuildMemberUpdate, "GUILD_MEMBER_UPDATE", GUILD_MEMBERS },
+            // Only sent in reply to Request Guild Members.
+            { Event::GuildMembersChunk, "GUILD_MEMBERS_CHUNK", 0 },
+            { Event::GuildRoleCreate, "GUILD_ROLE_CREATE", GUILDS },
+            { Event::GuildRoleUpdate, "GUILD_ROLE_UPDATE", GUILDS },
+            { Event::GuildRoleDelete, "GUILD_ROLE_DELETE", GUILDS },
+            { Event::GuildScheduledEventCreate, "GUILD_SCHEDULED_EVENT_CREATE", GUILD_SCHEDULED_EVENTS },
+            { Event::GuildScheduledEventUpdate, "GUILD_SCHEDULED_EVENT_UPDATE", GUILD_SCHEDULED_EVENTS },
+            { Event::GuildScheduledEventDelete, "GUILD_SCHEDULED_EVENT_DELETE", GUILD_SCHEDULED_EVENTS },
+            { Event::GuildScheduledEventUserAdd, "GUILD_SCHEDULED_EVENT_USER_ADD", GUILD_SCHEDULED_EVENTS },
+            { Event::GuildScheduledEventUserRemove, "GUILD_SCHEDULED_EVENT_USER_REMOVE", GUILD_SCHEDULED_EVENTS },
+            { Event::IntegrationCreate, "INTEGRATION_CREATE", GUILD_INTEGRATIONS },
+            { Event::IntegrationUpdate, "INTEGRATION_UPDATE", GUILD_INTEGRATIONS },
+            { Event::IntegrationDelete, "INTEGRATION_DELETE", GUILD_INTEGRATIONS },
+            { Event::InteractionCreate, "INTERACTION_CREATE", 0 },
+            { Event::InviteCreate, "INVITE_CREATE", GUILD_INVITES },
+            { Event::InviteDelete, "INVITE_DELETE", GUILD_INVITES },
+            { Event::MessageCreate, "MESSAGE_CREATE", GUILD_MESSAGES | DIRECT_MESSAGES },
+            { Event::MessageUpdate, "MESSAGE_UPDATE", GUILD_MESSAGES | DIRECT_MESSAGES },
+            { Event::MessageDelete, "MESSAGE_DELETE", GUILD_MESSAGES | DIRECT_MESSAGES },
+            { Event::MessageDeleteBulk, "MESSAGE_DELETE_BULK", GUILD_MESSAGES },
+            { Event::MessageReactionAdd, "MESSAGE_REACTION_ADD", GUILD_MESSAGE_REACTIONS | DIRECT_MESSAGE_REACTIONS },
+            { Event::MessageReactionRemove, "MESSAGE_REACTION_REMOVE", GUILD_MESSAGE_REACTIONS | DIRECT_MESSAGE_REACTIONS },
+            { Event::MessageReactionRemoveAll, "MESSAGE_REACTION_REMOVE_ALL", GUILD_MESSAGE_REACTIONS | DIRECT_MESSAGE_REACTIONS },
+            { Event::MessageReactionRemoveEmoji, "MESSAGE_REACTION_REMOVE_EMOJI", GUILD_MESSAGE_REACTIONS | DIRECT_MESSAGE_REACTIONS },
+            { Event::StageInstanceCreate, "STAGE_INSTANCE_CREATE", GUILDS },
+            { Event::StageInstanceUpdate, "STAGE_INSTANCE_UPDATE", GUILDS },
+            { Event::StageInstanceDelete, "STAGE_INSTANCE_DELETE", GUILDS },
+            { Event::TypingStart, "TYPING_START", GUILD_MESSAGE_TYPING | DIRECT_MESSAGE_TYPING },
+            { Event::UserUpdate, "USER_UPDATE", 0 },
+            { Event::VoiceServerUpdate, "VOICE_SERVER_UPDATE", 0 },
+            { Event::WebhooksUpdate, "WEBHOOKS_UPDATE", GUILD_WEBHOOKS },
+        };
+
+        constexpr bool eventsInOrder(size_t i = 0) {
+            return i == Bot::EVENT_COUNT ||
+                (static_cast<size_t>(EVENTS[i].event) == i && eventsInOrder(i + 1));
+        }
+        static_assert(sizeof(EVENTS) / sizeof(EVENTS[0]) == Bot::EVENT_COUNT, "Every event needs a descriptor.");
+        static_assert(eventsInOrder(), "Event descriptors must be in the order of Bot::Event.");
+
+        // Dispatch names not given their own Event are reported as Dispatch.
+        Event eventNamed(const char* name) {
+            if (name == nullptr) return Event::Dispatch;
+            for (const Bot::EventDescriptor& descriptor : EVENTS) {
+                if (descriptor.name && strcmp(descriptor.name, name) == 0) return descriptor.event;
+            }
+            return Event::Dispatch;
+        }
+
+        // The option being typed in an autocomplete interaction, looking inside subcommands and groups.
+        JsonObjectConst focusedOption(JsonArrayConst options) {
+            for (JsonObjectConst option : options) {
+                if (option["focused"] == true) return option;
+                if (option.containsKey("options")) {
+                    JsonObjectConst nested = focusedOption(option["options"]);
+                    if (!nested.isNull()) return nested;
+                }
+            }
+            return JsonObjectConst();
+        }
+
+        inline const char* stringOf(JsonVariantConst value) {
+            return value.is<const char*>() ? value.as<const char*>() : "";
+        }
+
+        void readUser(JsonObjectConst json, Bot::User& user) {
+            user.id = json["id"];
+            user.username = stringOf(json["username"]);
+            user.globalName = stringOf(json["global_name"]);
+            user.bot = json["bot"] | false;
+        }
+
+        // Reads every field once, so handlers do not search the document again.
+        void readInteraction(JsonObjectConst json, Bot::Interaction& interaction) {
+            interaction.json = json;
+            interaction.id = json["id"];
+            interaction.applicationId = json["application_id"];
+            interaction.type = static_cast<Bot::Interaction::Type>(json["type"].as<int>());
+            interaction.guildId = json["guild_id"];
+            interaction.channelId = json["channel_id"];
+            interaction.version = json["version"] | 1;
+            interaction.appPermissions = json["app_permissions"];
+            interaction.locale = stringOf(json["locale"]);
+            interaction.guildLocale = stringOf(json["guild_locale"]);
+
+            JsonObjectConst data = json["data"];
+            interaction.data.commandId = data["id"];
+            interaction.data.name = stringOf(data["name"]);
+            interaction.data.type = data["type"];
+            interaction.data.guildId = data["guild_id"];
+            interaction.data.targetId = data["target_id"];
+            interaction.data.options = data["options"];
+
+            // Guild interactions carry the user inside the member object, DMs carry it directly.
+            JsonObjectConst member = json["member"];
+            if (!member.isNull()) {
+                interaction.member.nick = stringOf(member["nick"]);
+                interaction.member.permissions = member["permissions"];
+                interaction.member.pending = member["pending"] | false;
+                readUser(member["user"], interaction.user);
             }
             else {
+                readUser(json["user"], interaction.user);
+            }
+        }
+    }
+
 #ifdef ESP32
-                log_e(DISCORD_MESSAGE_PREFIX "Failed to set Gateway URL.");
-#else
-                Serial.println(DISCORD_MESSAGE_PREFIX "Failed to set Gateway URL.");
+    namespace {
+        // Session state kept in RTC memory, which survives software resets, panics and watchdog resets, but not
+        // power loss. The sequence is written on every dispatch, which would wear out NVS flash.
+        struct SessionCheckpoint {
+            uint32_t magic;
+            uint32_t checksum;
+            uint64_t applicationId;
+            // Shards of the session, 0 if it was not sharded.
+            uint32_t shardCount;
+            char sessionId[SessionId::CAPACITY + 1];
+            char resumeGatewayURL[GatewayHost::CAPACITY + 1];
+            uint32_t sequence;
+            uint32_t sequenceCheck;
+        };
+
+        constexpr uint32_t SESSION_CHECKPOINT_MAGIC = 0x44534301;
+
+        RTC_NOINIT_ATTR SessionCheckpoint sessionCheckpoint;
+
+        // FNV-1a over everything but the sequence, which carries its own complement check.
+        uint32_t checksum(const SessionCheckpoint& checkpoint) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&checkpoint.applicationId);
+            size_t length = offsetof(SessionCheckpoint, sequence) - offsetof(SessionCheckpoint, applicationId);
+            uint32_t hash = 2166136261u;
+            for (size_t i = 0; i < length; ++i) {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+            return hash;
+        }
+    }
 #endif
-                return;
+
+    namespace {
+        // When each identify bucket was last claimed, shared by every Bot in the process.
+        std::mutex identifyMtx;
+        unsigned long identifyClaimed[DISCORD_IDENTIFY_BUCKETS];
+        bool identifyUsed[DISCORD_IDENTIFY_BUCKETS];
+
+        bool claimIdentify(size_t bucket, unsigned long now) {
+            bucket %= DISCORD_IDENTIFY_BUCKETS;
+            std::lock_guard<std::mutex> lock(identifyMtx);
+            if (identifyUsed[bucket] && now - identifyClaimed[bucket] < DISCORD_IDENTIFY_INTERVAL) return false;
+            identifyUsed[bucket] = true;
+            identifyClaimed[bucket] = now;
+            return true;
+        }
+    }
+
+    Bot::Bot(const char* botToken, bool enableRateLimit) :
+        _botToken { botToken }, _rateLimit { enableRateLimit } {
+        restoreSession();
+    }
+
+    void Bot::restoreSession() {
+#ifdef ESP32
+        const SessionCheckpoint& checkpoint = sessionCheckpoint;
+        if (checkpoint.magic != SESSION_CHECKPOINT_MAGIC || checkpoint.checksum != checksum(checkpoint) ||
+            checkpoint.sequence != ~checkpoint.sequenceCheck) {
+            return;
+        }
+        // Only shard 0 checkpoints its session, and only a session with the same sharding can be resumed.
+        bool matches = _sharded ?
+            checkpoint.shardCount != 0 && (_shardCount == 0 || checkpoint.shardCount == _shardCount) :
+            checkpoint.shardCount == 0;
+        if (_shardId != 0 || !matches) return;
+        if (_sharded) {
+            _shardCount = checkpoint.shardCount;
+        }
+        _applicationId = checkpoint.applicationId;
+        _sessionId = checkpoint.sessionId;
+        _resumeGatewayURL = checkpoint.resumeGatewayURL;
+        _lastSocketSequence = checkpoint.sequence;
+        DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Restored session to resume on %s, sequence %u",
+            _resumeGatewayURL.c_str(), _lastSocketSequence);
+#endif
+    }
+
+    void Bot::checkpointSession() {
+#ifdef ESP32
+        // The checkpoint has room for one session. Other shards identify afresh after a reset.
+        if (_shardId != 0) return;
+        SessionCheckpoint& checkpoint = sessionCheckpoint;
+        memset(&checkpoint, 0, sizeof(checkpoint));
+        checkpoint.applicationId = _applicationId;
+        checkpoint.shardCount = _sharded ? _shardCount : 0;
+        strlcpy(checkpoint.sessionId, _sessionId.c_str(), sizeof(checkpoint.sessionId));
+        strlcpy(checkpoint.resumeGatewayURL, _resumeGatewayURL.c_str(), sizeof(checkpoint.resumeGatewayURL));
+        checkpoint.checksum = checksum(checkpoint);
+        checkpoint.magic = SESSION_CHECKPOINT_MAGIC;
+        checkpointSequence();
+#endif
+    }
+
+    inline void Bot::checkpointSequence() {
+#ifdef ESP32
+        if (_shardId != 0) return;
+        sessionCheckpoint.sequence = _lastSocketSequence;
+        sessionCheckpoint.sequenceCheck = ~_lastSocketSequence;
+#endif
+    }
+
+    void Bot::clearSessionCheckpoint() {
+#ifdef ESP32
+        if (_shardId != 0) return;
+        sessionCheckpoint.magic = 0;
+#endif
+    }
+
+    JsonVariantConst Bot::Interaction::option(const char* name) const {
+        for (JsonObjectConst option : data.options) {
+            if (option["name"] == name) return option["value"];
+        }
+        return JsonVariantConst();
+    }
+
+    const Bot::EventDescriptor& Bot::describe(Event event) {
+        return EVENTS[static_cast<size_t>(event)];
+    }
+
+    void Bot::subscribe(Event event, uint32_t intents) {
+        const EventDescriptor& descriptor = describe(event);
+        if (intents == 0 || (intents & ~descriptor.intents) != 0) {
+            if (intents != 0) {
+                DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "Intents %u do not all deliver %s, requesting %u instead.",
+                    static_cast<unsigned>(intents), descriptor.name ? descriptor.name : "an opcode",
+                    static_cast<unsigned>(descriptor.intents));
             }
+            intents = descriptor.intents;
         }
+        _subscribed.set(static_cast<size_t>(event));
+        _subscribedIntents |= intents;
+    }
 
+    void Bot::setShard(uint16_t id, uint16_t count) {
+        if (_active) {
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Shard must be set before login.");
+            return;
+        }
+        if (count != 0 && id >= count) {
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Shard %u is out of range for %u shards.", id, count);
+            return;
+        }
+        _sharded = true;
+        _shardId = id;
+        _shardCount = count;
+        // Only /gateway/bot gives the recommended shard count and the identify buckets, fetch them again.
+        _gatewayURL.clear();
+        // The session restored on construction assumed no sharding, look again for this shard's.
+        _sessionId.clear();
+        _resumeGatewayURL.clear();
+        _lastSocketSequence = 0;
+        restoreSession();
+    }
+
+    void Bot::login() {
+        login(_subscribedIntents);
+    }
+
+    void Bot::login(uint32_t intents) {
+        _intents = intents;
+        for (size_t i = 0; i < EVENT_COUNT; ++i) {
+            if (_subscribed.test(i) && EVENTS[i].intents != 0 && (EVENTS[i].intents & intents) == 0) {
+                DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "%s is handled, but none of the intents that deliver it are requested.",
+                    EVENTS[i].name);
+            }
+        }
+        if (intents & ~_subscribedIntents & ~Intents::MESSAGE_CONTENT) {
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "Intents %u are requested without a subscribed event.",
+                static_cast<unsigned>(intents & ~_subscribedIntents & ~Intents::MESSAGE_CONTENT));
+        }
+        if (intents & Intents::PRIVILEGED) {
+            DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Privileged intents %u must also be enabled on the developer portal.",
+                static_cast<unsigned>(intents & Intents::PRIVILEGED));
+        }
+        if (_active) return;
+
+        _active = true;
+        {
+            std::lock_guard<std::mutex> lock(_httpsMtx);
+            _https.begin(DISCORD_HOST, nullptr);
+            _https.collectHeaders(ResponseStream::HEADERS, ResponseStream::HEADER_COUNT);
+        }
+        _busyHttps.begin(DISCORD_HOST, nullptr);
+        _busyHttps.collectHeaders(ResponseStream::HEADERS, ResponseStream::HEADER_COUNT);
         _socket.onEvent([=](WStype_t type, uint8_t* payload, size_t length) {
             this->onWebSocketEvents(type, payload, length);
             });
-        Serial.print(DISCORD_MESSAGE_PREFIX "Attempting connection via WebSocket to ");
-        Serial.println(_gatewayURL);
-        _socket.beginSSL(_gatewayURL, 443, DISCORD_GATEWAY_SUFFIX);
+        _backoff = 0;
+        _connectFailures = 0;
+        _nextAttempt = _now;
+        setState(ConnectionState::Disconnected);
+    }
 
-        _intents = intents;
-        _heartbeatInterval = 0;
-        _lastHeartbeatAck = 0;
-        _lastHeartbeatSend = 0;
+    void Bot::withRestClient(const std::function<void(HTTPClient& client)>& request) {
+        std::lock_guard<std::mutex> lock(_httpsMtx);
+        if (!_active) {
+            _https.begin(DISCORD_HOST, nullptr);
+            _https.collectHeaders(ResponseStream::HEADERS, ResponseStream::HEADER_COUNT);
+        }
+        request(_https);
+        if (!_active) {
+            _https.end();
+        }
     }
 
     void Bot::update(unsigned long now) {
         _now = now;
+        if (!_active) return;
+
+        if (_state == ConnectionState::Disconnected) {
+            // The socket is not serviced while disconnected, so the library cannot reconnect on its own
+            // to a URL we no longer want. Reconnection is entirely driven from here.
+            if (static_cast<long>(now - _nextAttempt) >= 0) {
+                connect();
+            }
+            return;
+        }
+
+        // Waiting for an identify bucket to free up does not count towards the connection timeout.
+        if (_state != ConnectionState::Ready && !_identifyPending && now - _stateSince > DISCORD_CONNECT_TIMEOUT) {
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "Timed out connecting to the gateway.");
+            bool resuming = !_sessionId.isEmpty();
+            // Give up on a resume URL that keeps failing, and re-fetch a gateway URL that cannot be reached.
+            bool keepSession = resuming && ++_connectFailures < DISCORD_RESUME_ATTEMPTS;
+            if (!resuming) {
+                _gatewayURL.clear();
+            }
+            setState(ConnectionState::Disconnected);
+            dropConnection(keepSession);
+            scheduleReconnect();
+            return;
+        }
+
         _socket.loop();
         _online = _socket.isConnected();
-        if (!_online && !_gatewayURL.isEmpty()) {
-            //Clear gateway/resume URL cache
-            _gatewayURL.clear();
-            return;
+        if (_state == ConnectionState::Disconnected) return;
+
+        if (_identifyPending) {
+            identify();
         }
 
         if (_rateLimit && now - _lastRateReset > 60000) {
@@ -75,30 +453,153 @@ namespace Discord {
             _lastRateReset = now;
         }
 
+        if (_heartbeatsOutstanding > 0 && millis() - _heartbeatSentAt > heartbeatAckTimeout()) {
+            // No ACK for the last heartbeat: the connection is zombied. Drop it without clearing the session
+            // and resume on the next update.
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "Heartbeat acknowledgement timeout! Resuming.");
+            Metrics::registry.heartbeatTimeouts.increment();
+            reconnectNow(true);
+            return;
+        }
+
         if (_heartbeatInterval > 0 && _now > (_firstHeartbeat > 0 ? _lastHeartbeatSend + _firstHeartbeat : _lastHeartbeatSend + _heartbeatInterval)) {
             heartbeat();
             _firstHeartbeat = 0;
         }
+        else if (_restKeepAliveDue) {
+            keepRestAlive();
+        }
+    }
 
-        if (_lastHeartbeatAck > _lastHeartbeatSend + (_heartbeatInterval / 2))
-        {
-#ifdef ESP32
-            log_w(DISCORD_MESSAGE_PREFIX "Heartbeat acknowledgement timeout!");
-#else
-            Serial.println(DISCORD_MESSAGE_PREFIX "Heartbeat acknowledgement timeout!");
-#endif
-            logout();
+    void Bot::keepRestAlive() {
+        _restKeepAliveDue = false;
+        // A response task holding the client is keeping the connection alive already, so this is skipped
+        // rather than waited for.
+        std::unique_lock<std::mutex> lock(_httpsMtx, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+        // Send a periodic request to Discord to preserve the TCP connection.
+        sendRest(_https, "GET", DISCORD_API_URI "/gateway");
+    }
+
+    void Bot::connect() {
+        //Establish a connection with the Gateway after fetching and caching a WSS URL using the Get Gateway endpoint.
+        //A session that can still be resumed goes straight back to its resume URL instead.
+        bool resuming = !_sessionId.isEmpty() && !_resumeGatewayURL.isEmpty();
+        if (!resuming && _gatewayURL.isEmpty()) {
+            setState(ConnectionState::FetchingGateway);
+            // Shards ask the authenticated endpoint, which also gives the recommended shard count and how many
+            // sessions may identify at once.
+            ArenaJsonDocument filter(JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(1), ArenaAllocator(_arena));
+            filter["url"] = true;
+            if (_sharded) {
+                filter["shards"] = true;
+                filter["session_start_limit"]["max_concurrency"] = true;
+            }
+            // Keys and the URL are copied out of the response, on top of the slots the filter lets through.
+            ArenaJsonDocument doc(JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(1) + 128, ArenaAllocator(_arena));
+            bool fetched;
+            {
+                // Response tasks from before a reconnect may still be sending on the client.
+                std::lock_guard<std::mutex> lock(_httpsMtx);
+                fetched = _sharded ?
+                    sendRest(_https, "GET", DISCORD_API_URI "/gateway/bot", "", _botToken, &doc, &filter) :
+                    sendRest(_https, "GET", DISCORD_API_URI "/gateway", "", "", &doc, &filter);
+            }
+            if (fetched && doc["url"].is<const char*>()) {
+                _gatewayURL = doc["url"].as<const char*>() + 6; // Remove the 'wss://' prefix
+                DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Gateway URL set to %s", _gatewayURL.c_str());
+            }
+            else {
+                DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Failed to set Gateway URL.");
+                scheduleReconnect();
+                return;
+            }
+
+            if (_sharded) {
+                _maxConcurrency = max(doc["session_start_limit"]["max_concurrency"].as<uint16_t>(), static_cast<uint16_t>(1));
+                if (_shardCount == 0) {
+                    _shardCount = max(doc["shards"].as<uint16_t>(), static_cast<uint16_t>(1));
+                    DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Using the recommended %u shards.", _shardCount);
+                }
+                if (_shardId >= _shardCount) {
+                    DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Shard %u is out of range for %u shards, logging out.",
+                        _shardId, _shardCount);
+                    logout();
+                    return;
+                }
+            }
         }
+
+        const char* url = resuming ? _resumeGatewayURL.c_str() : _gatewayURL.c_str();
+        DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Attempting connection via WebSocket to %s", url);
+        _socket.beginSSL(url, 443, DISCORD_GATEWAY_SUFFIX);
+        // WebSocket pings catch a dead TCP path between gateway heartbeats, which can be over 40s apart.
+        _socket.enableHeartbeat(DISCORD_WS_PING_INTERVAL, DISCORD_WS_PONG_TIMEOUT, DISCORD_WS_PONG_MISSES);
+
+        _heartbeatInterval = 0;
+        _lastHeartbeatAck = 0;
+        _lastHeartbeatSend = 0;
+        _heartbeatsOutstanding = 0;
+        setState(ConnectionState::Connecting);
     }
 
-    void Bot::logout() {
-        if (_socket.isConnected()) {
-            _socket.disconnect();
-            _online = false;
+    void Bot::dropConnection(bool keepSession) {
+        // Callers move to Disconnected first, so the WStype_DISCONNECTED raised from here is not treated as a failure.
+        _socket.disconnect();
+        _online = false;
+        _heartbeatInterval = 0;
+        _heartbeatsOutstanding = 0;
+        _identifyPending = false;
+        if (!keepSession) {
             _sessionId.clear();
-            Serial.println(DISCORD_MESSAGE_PREFIX "Logout complete.");
+            _resumeGatewayURL.clear();
+            clearSessionCheckpoint();
+        }
+    }
+
+    void Bot::reconnectNow(bool keepSession, unsigned long delay) {
+        setState(ConnectionState::Disconnected);
+        dropConnection(keepSession);
+        _nextAttempt = _now + delay;
+    }
+
+    void Bot::scheduleReconnect() {
+        _backoff = _backoff == 0 ? DISCORD_RECONNECT_BACKOFF_MIN : min(_backoff * 2, static_cast<unsigned long>(DISCORD_RECONNECT_BACKOFF_MAX));
+        // Jitter over the upper half of the backoff keeps many clients from retrying in lockstep.
+        unsigned long delay = _backoff / 2 + random(0, _backoff / 2 + 1);
+        _nextAttempt = _now + delay;
+        setState(ConnectionState::Disconnected);
+        DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Reconnecting in (ms): %lu", delay);
+    }
+
+    void Bot::setState(ConnectionState state) {
+        _state = state;
+        _stateSince = _now;
+        if (state == ConnectionState::Ready) {
+            _backoff = 0;
+            _connectFailures = 0;
+        }
+    }
+
+    unsigned long Bot::heartbeatAckTimeout() {
+        unsigned long timeout = max(static_cast<unsigned long>(DISCORD_HEARTBEAT_ACK_TIMEOUT), 4 * _heartbeatRtt);
+        if (_heartbeatInterval > 0 && timeout > _heartbeatInterval) {
+            timeout = _heartbeatInterval;
+        }
+        return timeout;
+    }
+
+    void Bot::logout() {
+        _active = false;
+        setState(ConnectionState::Disconnected);
+        dropConnection(false);
+        {
+            // Waits for any response still being sent.
+            std::lock_guard<std::mutex> lock(_httpsMtx);
+            _https.end();
         }
-        _https.end();
+        _busyHttps.end();
+        DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Logout complete.");
     }
 
     void Bot::onEvent(const EventCallback& cb) {
@@ -109,118 +610,172 @@ namespace Discord {
         _interactionCallback = cb;
     }
 
-    inline void Bot::sendCommandResponse(const InteractionResponse& type, const StaticJsonDocument<512>& response) {
+    void Bot::onAutocomplete(const AutocompleteCallback& cb) {
+        _autocompleteCallback = cb;
+    }
+
+    inline void Bot::sendCommandResponse(const InteractionResponse& type, const JsonDocument& response) {
+        if (_inlineReply != nullptr) {
+            // Received over HTTP, the response goes back in the reply and there is no callback request.
+            _inlineReply->reserve(measureJson(response));
+            serializeJson(response, *_inlineReply);
+            Metrics::registry.interactionLatency.observe(millis() - _interactionReceived);
+            return;
+        }
 
 #ifdef _DISCORD_CLIENT_DEBUG
         unsigned long start = millis();
+        unsigned long buildStart = micros();
 #endif
 
-        String url(DISCORD_API_URI "/interactions/");
-        url.reserve(sizeof(uint64_t) + _interactionToken.length() + 11);
+        RestPath url(DISCORD_API_URI "/interactions/");
         url += _interactionId;
         url += "/";
-        url += _interactionToken;
+        url += _interactionToken.c_str();
         url += "/callback";
 
-        String json((char*)0);
-        json.reserve(256);
-        serializeJson(response, json);
+        if (!admitResponse(measureJson(response))) {
+            sendBusyResponse(type, url.c_str());
+            return;
+        }
 
-        sendPostAsync<256>(_https, "POST", std::move(url), json, _botToken,
 #ifdef _DISCORD_CLIENT_DEBUG
-            [start](const StaticJsonDocument<256>& response) {
-#else
-            [](const StaticJsonDocument<256>& response) {
+        DISCORD_LOGD("[PROFILE] Response body: %ub from a %ub document, built in (us): %lu",
+            static_cast<unsigned>(measureJson(response)), static_cast<unsigned>(response.memoryUsage()),
+            micros() - buildStart);
 #endif
-#ifdef ESP32
-                log_i(DISCORD_MESSAGE_PREFIX "[COMMAND] Response sent.");
+
+        unsigned long received = _interactionReceived;
+        unsigned long sent = millis();
+        // The request serializes the body into a buffer of its own, the document is gone once this returns.
+        bool queued = sendPostAsync<256>(_https, "POST", url.c_str(), response, _botToken,
+#ifdef _DISCORD_CLIENT_DEBUG
+            [start, received, sent](const StaticJsonDocument<256>& response) {
 #else
-                Serial.println("[COMMAND] Response sent.");
+            [received, sent](const StaticJsonDocument<256>& response) {
 #endif
+                unsigned long acknowledged = millis();
+                Metrics::registry.interactionPost.observe(acknowledged - sent);
+                Metrics::registry.interactionLatency.observe(acknowledged - received);
+                DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "[COMMAND] Response sent.");
 #ifdef _DISCORD_CLIENT_DEBUG
-                unsigned long end = millis();
-                Serial.print("Time to respond (ms): ");
-                Serial.println(end - start);
+                DISCORD_LOGD("Time to respond (ms): %lu", millis() - start);
 #endif
-            }, & _httpsMtx);
+            }, & _httpsMtx, & _responsesInFlight);
+
+        if (!queued) {
+            sendBusyResponse(type, url.c_str());
+        }
+    }
+
+    bool Bot::admitResponse(size_t length) {
+        // What the response costs until its task ends: the task's stack, the request and its body.
+        size_t cost = Stack::size(Stack::Task::Post, DISCORD_POST_TASK_STACK) + 256 + sizeof(AsyncAPIRequest<256>) + length;
+        unsigned int inFlight = _responsesInFlight.load(std::memory_order_relaxed);
+        if (inFlight >= DISCORD_RESPONSES_IN_FLIGHT_MAX) {
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "[COMMAND] %u responses already in flight, shedding.", inFlight);
+            return false;
+        }
+        uint32_t heap = freeHeap();
+        if (heap < cost + DISCORD_RESPONSE_HEAP_RESERVE) {
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "[COMMAND] %ub of heap free, %ub needed, shedding.",
+                static_cast<unsigned>(heap), static_cast<unsigned>(cost + DISCORD_RESPONSE_HEAP_RESERVE));
+            return false;
+        }
+        return true;
+    }
 
-        return;
+    void Bot::sendBusyResponse(const InteractionResponse& type, const char* url) {
+        // Built once, sending them needs no document, serialization or task.
+        static const String busy("{\"type\":4,\"data\":{\"content\":\"" DISCORD_BUSY_MESSAGE "\",\"flags\":64}}");
+        // Autocomplete cannot be answered with a message, so it is shed with no suggestions.
+        static const String noChoices("{\"type\":8,\"data\":{\"choices\":[]}}");
+
+        Metrics::registry.responsesShed.increment();
+        // Sent on a client of its own, waiting behind the response tasks holding _https could take their whole
+        // request timeouts, stalling heartbeats and missing the 3s window for this reply.
+        sendRest(_busyHttps, "POST", url,
+            type == InteractionResponse::APPLICATION_COMMAND_AUTOCOMPLETE_RESULT ? noChoices : busy, _botToken);
     }
 
     void Bot::sendCommandResponse(const InteractionResponse & type, const MessageResponse & response) {
-        if (_interactionId == 0 || _interactionToken.isEmpty()) {
-#ifdef ESP32
-            log_e(DISCORD_MESSAGE_PREFIX "[COMMAND] No token or id available!");
-#else
-            Serial.println(DISCORD_MESSAGE_PREFIX "[COMMAND] No token or id available!");
-#endif
+        // Replies given inline over HTTP need no token.
+        if (_interactionId == 0 || (_interactionToken.isEmpty() && _inlineReply == nullptr)) {
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "[COMMAND] No token or id available!");
             return;
         }
-        StaticJsonDocument<512> doc;
+        ArenaJsonDocument doc(512, ArenaAllocator(_arena));
         doc["type"] = static_cast<unsigned short>(type);
         JsonObject data = doc.createNestedObject("data");
         if (response.tts) {
             data["tts"] = true;
         }
+        // Responses over the in-flight or heap budget are shed by sendCommandResponse().
+        data["content"] = response.content;
 
-        /*
-        This theory and its following safeguard is currently untested.
+        if (static_cast<uint8_t>(response.flags)) {
+            data["flags"] = static_cast<uint8_t>(response.flags);
+            DISCORD_LOGD("Flags: %u", static_cast<uint8_t>(response.flags));
+        }
 
-        Buffer safety: If too many simultaneous interactions come in, the ESP32 will have trouble responding to all
-        of the interactions sequentially within their allotted 3-second window due to not having enough heap space to
-        queue and send responses. If that happens, a warning message is appended to the last possible response
-        to notify users the bot is being overloaded, and the bot will fail to respond to subsequent interactions until
-        the existing responses have been sent out.
-        */
-        if (esp_get_free_heap_size() > 2 * (4 * 1024 + 256)) {
-            data["content"] = response.content;
+        sendCommandResponse(type, doc);
+    }
+
+    void Bot::sendAutocompleteResult(const char* const* suggestions, size_t count) {
+        if (_interactionId == 0 || (_interactionToken.isEmpty() && _inlineReply == nullptr)) {
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "[COMMAND] No token or id available!");
+            return;
         }
-        else {
-            String msg((char*)0);
-            msg.reserve(strlen(response.content) + 102);
-            msg += response.content;
-            msg += "\n\n**Warning: Not enough memory for further processing. Please wait before sending further commands.**";
-            data["content"] = msg;
+        if (count > DISCORD_AUTOCOMPLETE_CHOICES_MAX) {
+            count = DISCORD_AUTOCOMPLETE_CHOICES_MAX;
         }
 
-
-        if (static_cast<uint8_t>(response.flags)) {
-            data["flags"] = static_cast<uint8_t>(response.flags);
-            Serial.print("Flags: ");
-            Serial.println(static_cast<uint8_t>(response.flags));
+        ArenaJsonDocument doc(JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(1) + JSON_ARRAY_SIZE(count) +
+            count * JSON_OBJECT_SIZE(2), ArenaAllocator(_arena));
+        doc["type"] = static_cast<unsigned short>(InteractionResponse::APPLICATION_COMMAND_AUTOCOMPLETE_RESULT);
+        JsonArray choices = doc.createNestedObject("data").createNestedArray("choices");
+        for (size_t i = 0; i < count; ++i) {
+            JsonObject choice = choices.createNestedObject();
+            choice["name"] = suggestions[i];
+            choice["value"] = suggestions[i];
         }
 
-        sendCommandResponse(type, doc);
+        sendCommandResponse(InteractionResponse::APPLICATION_COMMAND_AUTOCOMPLETE_RESULT, doc);
     }
 
     void Bot::onWebSocketEvents(WStype_t type, uint8_t * payload, size_t length) {
         switch (type) {
             case WStype_ERROR:
                 if (payload) {
-                    Serial.print(DISCORD_MESSAGE_PREFIX "WebSocket error occured: ");
-                    Serial.println((char*)payload);
+                    DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "WebSocket error occured: %.*s", static_cast<int>(length), (char*)payload);
                 }
                 else {
-                    Serial.println(DISCORD_MESSAGE_PREFIX "A WebSocket connection error has occured.");
+                    DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "A WebSocket connection error has occured.");
                 }
                 break;
             case WStype_DISCONNECTED:
-                Serial.println(DISCORD_MESSAGE_PREFIX "Connection closed.");
+                DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Connection closed.");
+                if (_online) {
+                    Metrics::registry.gatewayDisconnects.increment();
+                }
                 _online = false;
+                if (_state != ConnectionState::Disconnected) {
+                    // Dropped by the network or by Discord rather than by us.
+                    scheduleReconnect();
+                }
                 break;
             case WStype_CONNECTED:
-                Serial.println(DISCORD_MESSAGE_PREFIX "Connected to gateway.");
+                DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Connected to gateway.");
+                Metrics::registry.gatewayConnects.increment();
                 _online = true;
                 break;
             case WStype_TEXT:
-#ifdef _DISCORD_CLIENT_DEBUG
-#ifdef ESP32
-                log_v(DISCORD_MESSAGE_PREFIX "Message received.");
-#else
-                Serial.println(DISCORD_MESSAGE_PREFIX "Message received.");
-#endif
-#endif
+                DISCORD_LOGV(DISCORD_MESSAGE_PREFIX "Message received.");
+                _frameReceived = millis();
+                _frameReceivedWall = wallClock();
                 parseMessage(payload, length);
+                Metrics::registry.jsonArenaHighWater.set(_arena.highWater());
+                Metrics::registry.jsonArenaFailures.set(_arena.failures());
                 break;
             case WStype_BIN:
                 break;
@@ -233,97 +788,99 @@ namespace Discord {
             case WStype_FRAGMENT_FIN:
                 break;
             case WStype_PING:
-                Serial.println(DISCORD_MESSAGE_PREFIX "Ping received.");
+                // The library answers pings itself.
+                DISCORD_LOGV(DISCORD_MESSAGE_PREFIX "Ping received.");
                 break;
             case WStype_PONG:
-                Serial.println(DISCORD_MESSAGE_PREFIX "Pong received.");
+                // Missed pongs are counted by the library, which disconnects after DISCORD_WS_PONG_MISSES.
+                DISCORD_LOGV(DISCORD_MESSAGE_PREFIX "Pong received.");
                 break;
         }
     }
 
     void Bot::parseMessage(uint8_t * payload, size_t length) {
+#ifdef _DISCORD_CLIENT_DEBUG
+        unsigned long parseStart = micros();
+        uint32_t heapBefore = freeHeap();
+#endif
+        // Nothing outlives a frame, so each one starts with the whole arena.
+        _arena.reset();
         //Deserialize the first part of our payload
-        DynamicJsonDocument doc(2048);
+        ArenaJsonDocument doc(DISCORD_FRAME_DOCUMENT_SIZE, ArenaAllocator(_arena));
         DeserializationError e = deserializeJson(doc, payload, length);
         if (e) {
-            Serial.print("Payload deserializeJson() call failed with code ");
-            Serial.println(e.c_str());
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Payload deserializeJson() call failed with code %s", e.c_str());
             // Handle the error here, don't pass it upward.
             return;
         }
 
 #ifdef _DISCORD_CLIENT_DEBUG
+        FrameProfile profile(doc, length, parseStart, heapBefore);
         serializeJsonPretty(doc, Serial);
         Serial.println();
 #endif
 
+        Metrics::registry.recordOpcode(doc[_op].as<int>());
+
         switch (static_cast<Event>(doc[_op].as<int>()))
         {
-            case Event::Dispatch:
+            case Event::Dispatch: {
                 // Dispatch (opcode 0) events are the most common type of event.
                 // Most Gateway events which represent actions taking place in a guild will be sent as Dispatch events.
-                _lastSocketSequence = doc["s"];
-
-                if (_outerCallback != nullptr) {
-                    _outerCallback(Event::Dispatch, doc);
+                // Looked up once, so the checks below compare enums instead of strings.
+                Event event = eventNamed(doc[_t]);
+                if (event == Event::Ready) {
+                    // A new session numbers its events from 1 again.
+                    _lastSocketSequence = 0;
                 }
+                else if (doc["s"].as<unsigned int>() <= _lastSocketSequence) {
+                    // Replayed after a resume from a checkpoint that was already ahead of it. The sequence is
+                    // checkpointed before handlers run, so an event is delivered at most once, even across a crash.
+                    DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "Skipping duplicate dispatch, sequence %u", doc["s"].as<unsigned int>());
+                    return;
+                }
+                _lastSocketSequence = doc["s"];
+                checkpointSequence();
+                Metrics::registry.recordDispatch(doc[_t].as<const char*>());
 
-                if (doc[_t] == "READY") {
+                if (event == Event::Ready) {
                     _ready = true;
                     _sessionId = doc[_d]["session_id"].as<const char*>();
-                    _gatewayURL = doc[_d]["resume_gateway_url"].as<const char*>() + 6;
+                    _resumeGatewayURL = doc[_d]["resume_gateway_url"].as<const char*>() + 6;
                     _applicationId = doc[_d]["application"]["id"];
-                    Serial.print(DISCORD_MESSAGE_PREFIX "Gateway URL set to resume on ");
-                    Serial.println(_gatewayURL);
-                    Serial.println(DISCORD_MESSAGE_PREFIX "Ready to comply.");
-                    if (_outerCallback != nullptr) {
-                        _outerCallback(Event::Ready, doc);
-                    }
+                    checkpointSession();
+                    setState(ConnectionState::Ready);
+                    DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Gateway URL set to resume on %s", _resumeGatewayURL.c_str());
+                    DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Ready to comply.");
+                    deliver(event, doc);
                     return;
                 }
-                else if (doc[_t] == "RESUMED") {
-                    Serial.println(DISCORD_MESSAGE_PREFIX "Session resumed.");
-                    if (_outerCallback != nullptr) {
-                        _outerCallback(Event::Resumed, doc);
-                    }
+                else if (event == Event::Resumed) {
+                    DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Session resumed.");
+                    setState(ConnectionState::Ready);
+                    deliver(event, doc);
                     return;
                 }
-                else if (doc[_t] == "INTERACTION_CREATE") {
-                    _interactionToken.reserve(256);
-                    _interactionToken = doc[_d]["token"].as<const char*>();
-                    _interactionId = doc[_d]["id"];
-
-                    const char* interactionName = doc[_d]["data"]["name"];
-                    Serial.print(DISCORD_MESSAGE_PREFIX "[COMMAND] Command ");
-                    Serial.print(doc[_d]["data"]["id"].as<const char*>());
-                    Serial.print(" used: ");
-                    Serial.println(interactionName);
-
-                    if (_interactionCallback != nullptr) {
-                        _interactionCallback(interactionName, doc[_d].as<JsonObject>());
-                    }
-                    else {
-                        Serial.println(DISCORD_MESSAGE_PREFIX "No interaction callback was found, no response given.");
-                    }
+                else if (event == Event::InteractionCreate) {
+                    deliver(event, doc);
+                    handleInteraction(doc[_d].as<JsonObjectConst>());
                     return;
                 }
                 // Privileged intent MESSAGE_CONTENT required to see message contents outside of DMs and mentions.
-                else if (doc[_t] == "MESSAGE_CREATE") {
+                else if (event == Event::MessageCreate) {
                     //Ignore our own messages
                     if (doc[_d]["author"]["id"].as<uint64_t>() == _applicationId) return;
-                    Serial.println(DISCORD_MESSAGE_PREFIX "New chat message received.");
-                    if (_outerCallback != nullptr) {
-                        _outerCallback(Event::MessageCreate, doc);
-                    }
+                    DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "New chat message received.");
+                    deliver(event, doc);
                     return;
                 }
-                if (_outerCallback != nullptr) {
-                    _outerCallback(static_cast<Event>(doc[_op].as<int>()), doc);
-                    return;
+                if (_outerCallback == nullptr && _eventHandlers == nullptr) {
+                    DISCORD_LOGD(DISCORD_MESSAGE_PREFIX "Unmanaged dispatch event type: %s", doc["t"].as<const char*>());
                 }
-                Serial.print(DISCORD_MESSAGE_PREFIX "Unmanaged dispatch event type: ");
-                Serial.println(doc["t"].as<const char*>());
+                // Dispatches without an Event of their own are delivered as Dispatch.
+                deliver(event, doc);
                 return;
+            }
             case Event::Heartbeat:
                 heartbeat();
                 break;
@@ -336,143 +893,255 @@ namespace Discord {
             case Event::Resume:
                 break;
             case Event::Reconnect:
-                logout();
-                login(_intents);
+                // Resume straight away on the cached resume URL.
+                DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Reconnect requested.");
+                reconnectNow(true);
                 break;
             case Event::RequestGuildMembers:
                 break;
             case Event::InvalidSession:
-                Serial.println(DISCORD_MESSAGE_PREFIX "Invalid session!");
+                // Discord asks for a random 1-5s wait before identifying or resuming again.
+                DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "Invalid session!");
                 if (doc[_d].as<bool>() == false) {
-                    Serial.println(DISCORD_MESSAGE_PREFIX "Clearing Gateway URL and session id.");
-                    _gatewayURL.clear();
-                    _sessionId.clear();
-                    logout();
-                    login(_intents);
+                    DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Clearing session id.");
+                    reconnectNow(false, random(1000, 5001));
                 }
                 else {
-                    logout();
+                    reconnectNow(true, random(1000, 5001));
                 }
                 break;
             case Event::Hello:
                 _heartbeatInterval = doc[_d]["heartbeat_interval"];
-                Serial.print(DISCORD_MESSAGE_PREFIX "Heartbeat interval (ms): ");
-                Serial.println(_heartbeatInterval);
+                DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Heartbeat interval (ms): %lu", _heartbeatInterval);
 
                 // Jitter is an offset value between 0 and heartbeat_interval that is meant to prevent too many clients 
                 // from reconnecting at the exact same time (which could cause an influx of traffic).
                 _firstHeartbeat = (random(0, 50) / 100.0f) * _heartbeatInterval;
-                Serial.print(DISCORD_MESSAGE_PREFIX "First heartbeat (ms):");
-                Serial.println(_firstHeartbeat);
+                DISCORD_LOGD(DISCORD_MESSAGE_PREFIX "First heartbeat (ms): %lu", _firstHeartbeat);
 
                 if (_sessionId.isEmpty()) {
                     identify();
                 }
                 else {
+                    setState(ConnectionState::Resuming);
                     resume();
                 }
 
                 _lastHeartbeatSend = _now;
                 _lastHeartbeatAck = _now;
+                _heartbeatsOutstanding = 0;
                 _lastRateReset = _now;
 
-                if (_outerCallback != nullptr) {
-                    _outerCallback(Event::Hello, doc);
-                }
+                deliver(Event::Hello, doc);
                 break;
             case Event::HeartbeatAck:
                 _lastHeartbeatAck = _now;
-#ifdef _DISCORD_CLIENT_DEBUG 
-#ifdef ESP32
-                log_v(DISCORD_MESSAGE_PREFIX "Heartbeat acknowledged.");
-#else
-                Serial.println(DISCORD_MESSAGE_PREFIX "Heartbeat acknowledged.");
-#endif
-#endif
+                if (_heartbeatsOutstanding > 0) {
+                    unsigned long rtt = millis() - _heartbeatSentAt;
+                    _heartbeatRtt = _heartbeatRtt == 0 ? rtt : (7 * _heartbeatRtt + rtt) / 8;
+                    _heartbeatsOutstanding = 0;
+                    Metrics::registry.heartbeatRtt.observe(rtt);
+                }
+                // Sent from update() once this frame is handled, so the request never sits inside an RTT sample.
+                _restKeepAliveDue = true;
+                DISCORD_LOGV(DISCORD_MESSAGE_PREFIX "Heartbeat acknowledged.");
                 break;
             default:
                 break;
         }
     }
 
+    void Bot::handleInteraction(JsonObjectConst json) {
+        _interactionReceived = _frameReceived;
+        Interaction interaction;
+        readInteraction(json, interaction);
+        if (!_interactionToken.assign(json["token"].as<const char*>()) && _inlineReply == nullptr) {
+            // Without the token there is no callback URL, so the handler's response cannot be sent.
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "[COMMAND] Interaction token is longer than %u characters, "
+                "interaction %llu will not be answered.", static_cast<unsigned>(InteractionToken::CAPACITY),
+                static_cast<unsigned long long>(interaction.id));
+        }
+        _interactionId = interaction.id;
+
+        unsigned long parsed = millis();
+        Metrics::registry.interactionParse.observe(parsed - _frameReceived);
+        uint64_t created = snowflakeTimestamp(interaction.id);
+        if (_frameReceivedWall != 0) {
+            // Clocks a little apart can put receipt before creation.
+            Metrics::registry.interactionTransit.observe(
+                _frameReceivedWall > created ? static_cast<uint32_t>(_frameReceivedWall - created) : 0);
+        }
+
+        if (interaction.type == Interaction::Type::APPLICATION_COMMAND_AUTOCOMPLETE) {
+            // Sent per keystroke, so only logged verbosely.
+            JsonObjectConst focused = focusedOption(interaction.data.options);
+            DISCORD_LOGV(DISCORD_MESSAGE_PREFIX "[COMMAND] Autocomplete for %s: %s",
+                interaction.data.name, stringOf(focused["name"]));
+            if (_autocompleteCallback != nullptr && !focused.isNull()) {
+                _autocompleteCallback(interaction.data.name, stringOf(focused["name"]),
+                    stringOf(focused["value"]), interaction);
+            }
+            return;
+        }
+        DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "[COMMAND] Command %llu used: %s",
+            static_cast<unsigned long long>(interaction.data.commandId), interaction.data.name);
+
+        if (_interactionCallback != nullptr || _interactionHandlers != nullptr) {
+            if (_interactionCallback != nullptr) {
+                _interactionCallback(interaction.data.name, interaction);
+            }
+            if (_interactionHandlers != nullptr) {
+                _interactionHandlers(interaction.data.name, interaction);
+            }
+            Metrics::registry.interactionHandler.observe(millis() - parsed);
+        }
+        else {
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "No interaction callback was found, no response given.");
+        }
+    }
+
+    bool Bot::setPublicKey(const char* publicKey) {
+        _publicKeySet = Signature::begin() && Signature::decodeHex(publicKey, _publicKey, sizeof(_publicKey));
+        if (!_publicKeySet) {
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Invalid public key, interactions over HTTP will be refused.");
+        }
+        return _publicKeySet;
+    }
+
+    int Bot::receiveInteraction(const char* signature, const char* timestamp, char* body, size_t length, String& reply) {
+        _frameReceived = millis();
+        _frameReceivedWall = wallClock();
+        // Discord sends requests with bad signatures on purpose, and stops using an endpoint that accepts them.
+        if (!_publicKeySet || !Signature::verify(_publicKey, signature, timestamp, body, length)) {
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "Refused an interaction with an invalid signature.");
+            return 401;
+        }
+
+        // Handled on the same task as gateway frames, so the arena is free. Parsed in place, a copy of every key and
+        // string of a guild interaction would not fit.
+        _arena.reset();
+        ArenaJsonDocument doc(DISCORD_FRAME_DOCUMENT_SIZE, ArenaAllocator(_arena));
+        DeserializationError e = deserializeJson(doc, body, length);
+        if (e) {
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Interaction deserializeJson() call failed with code %s", e.c_str());
+            return 400;
+        }
+
+        if (doc["type"] == static_cast<int>(Interaction::Type::PING)) {
+            reply = "{\"type\":1}";
+            return 200;
+        }
+
+        reply = "";
+        _inlineReply = &reply;
+        handleInteraction(doc.as<JsonObjectConst>());
+        _inlineReply = nullptr;
+        if (reply.isEmpty()) {
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "[COMMAND] The handler gave no response.");
+            return 500;
+        }
+        return 200;
+    }
+
+    inline void Bot::deliver(Event event, const JsonDocument& doc) {
+        if (_outerCallback == nullptr && _eventHandlers == nullptr) return;
+        EventView view;
+        view.event = event;
+        view.op = doc[_op];
+        view.sequence = doc["s"] | 0u;
+        view.name = doc[_t];
+        view.d = doc[_d];
+        if (_outerCallback != nullptr) {
+            _outerCallback(view);
+        }
+        if (_eventHandlers != nullptr) {
+            _eventHandlers(view);
+        }
+    }
+
     void Bot::identify() {
-        String payload;
-        StaticJsonDocument<256> doc;
+        if (!claimIdentify(_shardId % _maxConcurrency, _now)) {
+            if (!_identifyPending) {
+                DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Waiting for identify bucket %u.", _shardId % _maxConcurrency);
+            }
+            _identifyPending = true;
+            return;
+        }
+        _identifyPending = false;
+        setState(ConnectionState::Identifying);
+
+        char payload[256];
+        ArenaJsonDocument doc(JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(4) + JSON_ARRAY_SIZE(2) + JSON_OBJECT_SIZE(3),
+            ArenaAllocator(_arena));
 
         doc[_op] = 2;
 
         JsonObject d = doc.createNestedObject(_d);
         d["token"] = _botToken;
         d["intents"] = _intents;
+        if (_sharded) {
+            JsonArray shard = d.createNestedArray("shard");
+            shard.add(_shardId);
+            shard.add(_shardCount);
+        }
 
         JsonObject d_properties = d.createNestedObject("properties");
         d_properties["os"] = "esp32";
         d_properties["browser"] = "esp32";
         d_properties["device"] = "m5stack";
 
-        serializeJson(doc, payload);
+        size_t length = serializeJson(doc, payload);
 
-        if (!sendWS(payload.c_str(), payload.length())) return;
+        if (!sendWS(payload, length)) return;
 
-        Serial.print(DISCORD_MESSAGE_PREFIX "Identify event sent. Intents: ");
-        Serial.println(_intents);
+        DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Identify event sent. Intents: %u, shard %u/%u", _intents, _shardId, _shardCount);
     }
 
     void Bot::heartbeat() {
         if (!_socket.isConnected()) {
-            log_e(DISCORD_MESSAGE_PREFIX "Heartbeat not sent. No active connection.");
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Heartbeat not sent. No active connection.");
             return;
         }
-        String payload = "{\"op\":1,\"d\":";
-        if (_lastSocketSequence > 0) {
-            payload += _lastSocketSequence;
-            payload += "}";
-        }
-        else {
-            payload += "null}";
-        }
-
-        if (!sendWS(payload.c_str(), payload.length())) return;
-        // Send a periodic request to Discord to preserve the TCP connection.
-        sendRest(_https, "GET", DISCORD_API_URI "/gateway");
+        char payload[32];
+        int length = (_lastSocketSequence > 0) ?
+            snprintf(payload, sizeof(payload), "{\"op\":1,\"d\":%u}", _lastSocketSequence) :
+            snprintf(payload, sizeof(payload), "{\"op\":1,\"d\":null}");
 
+        if (!sendWS(payload, length)) return;
+        if (_heartbeatsOutstanding++ == 0) {
+            // Time the oldest unacknowledged heartbeat, a late ACK still counts against it.
+            _heartbeatSentAt = millis();
+        }
         _lastHeartbeatSend = _now;
 
-        if (_lastSocketSequence > 0) {
-            Serial.print(DISCORD_MESSAGE_PREFIX "Heartbeat sent. Sequence: ");
-            Serial.println(_lastSocketSequence);
-        }
-        else {
-            Serial.println(F(DISCORD_MESSAGE_PREFIX "Heartbeat sent."));
-        }
+        DISCORD_LOGD(DISCORD_MESSAGE_PREFIX "Heartbeat sent. Sequence: %u", _lastSocketSequence);
     }
 
     void Bot::resume() {
         if (_sessionId.isEmpty()) {
-            Serial.println(DISCORD_MESSAGE_PREFIX "No session id found! Unable to resume.");
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "No session id found! Unable to resume.");
         }
-        String payload;
-        StaticJsonDocument<256> doc;
+        char payload[256];
+        ArenaJsonDocument doc(JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(3), ArenaAllocator(_arena));
 
         doc[_op] = 6;
 
         JsonObject d = doc.createNestedObject(_d);
         d["token"] = _botToken;
-        d["session_id"] = _sessionId;
+        d["session_id"] = _sessionId.c_str();
         d["seq"] = _lastSocketSequence;
 
-        serializeJson(doc, payload);
+        size_t length = serializeJson(doc, payload);
 
-        if (!sendWS(payload.c_str(), payload.length())) return;
+        if (!sendWS(payload, length)) return;
 
-        Serial.println(_sessionId);
-        Serial.println(_lastSocketSequence);
-        Serial.println(DISCORD_MESSAGE_PREFIX "Resume event sent.");
+        DISCORD_LOGI(DISCORD_MESSAGE_PREFIX "Resume event sent. Session %s, sequence %u",
+            _sessionId.c_str(), _lastSocketSequence);
     }
 
     inline bool Bot::sendWS(const char* payload, size_t length) {
         if (_rateLimit && _eventsSent >= 120) {
-            Serial.println(DISCORD_MESSAGE_PREFIX "Rate limit reached! Maximum of 120 WebSocket events/min.");
+            DISCORD_LOGW(DISCORD_MESSAGE_PREFIX "Rate limit reached! Maximum of 120 WebSocket events/min.");
             return false;
         }
         if (_socket.sendTXT(payload, length)) {
@@ -482,64 +1151,89 @@ namespace Discord {
         return false;
     }
 
-    bool sendRest(HTTPClient & client, const char* method, const String & uri, const String & json, const char* authorisationToken) {
-        client.setURL(uri);
+    bool sendRest(HTTPClient & client, const char* method, const char* uri, const String & json, const char* authorisationToken) {
+        return sendRest(client, method, uri, json, authorisationToken, nullptr);
+    }
+
+    namespace {
+        void prepareRest(HTTPClient& client, const char* method, const char* uri, const char* authorisationToken) {
+            client.setURL(uri);
+            Metrics::registry.recordRestConnection(client.connected());
 
-        if (strcmp(method, "GET") != 0) {
-            client.addHeader("Content-Type", "application/json");
+            if (strcmp(method, "GET") != 0) {
+                client.addHeader("Content-Type", "application/json");
+            }
             if (strlen(authorisationToken) > 0) {
-                String headerTok = "Bot ";
+                AuthorisationHeader headerTok("Bot ");
                 headerTok += authorisationToken;
-                client.addHeader("Authorization", headerTok);
+                client.addHeader("Authorization", headerTok.c_str());
             }
         }
 
-        int httpResponseCode = 0;
-        if (!json.isEmpty()) {
-            httpResponseCode = client.sendRequest(method, json);
+        bool readRest(HTTPClient& client, const char* method, const char* uri, int httpResponseCode,
+            JsonDocument* responseDoc, const JsonDocument* filter) {
+            Metrics::registry.recordRestStatus(httpResponseCode);
+            DISCORD_LOGD(DISCORD_MESSAGE_PREFIX "Sent %s request to %s", method, uri);
 
-        }
-        else {
-            httpResponseCode = client.sendRequest(method);
-        }
-#ifdef _DISCORD_CLIENT_DEBUG
-#ifdef ESP32
-        log_d("[DISCORD] Sent %s request to %s", method, uri.c_str());
-#else
-        Serial.print(method);
-        Serial.print(" request to ");
-        Serial.println(uri);
-#endif
-#endif
-
-        if (httpResponseCode > 0) {
-#ifdef _DISCORD_CLIENT_DEBUG
-#ifdef ESP32
-            log_d("[DISCORD] HTTP Response code: %d", httpResponseCode);
-#else
-            Serial.print("[DISCORD] HTTP Response code: ");
-            Serial.println(httpResponseCode);
-#endif
-#endif
-            if (httpResponseCode != 204) { //204 no content
-#ifdef _DISCORD_CLIENT_DEBUG
-#ifdef ESP32
-                log_d("%s", client.getString().c_str());
-#else
-                Serial.println(client.getString());
-#endif
-#endif
-            }
-            if (httpResponseCode == 401) {
-                Serial.println("[DISCORD] 401 Not Authorised.");
-                return false;
+            if (httpResponseCode > 0) {
+                DISCORD_LOGD(DISCORD_MESSAGE_PREFIX "HTTP Response code: %d", httpResponseCode);
+                if (httpResponseCode != 204) { //204 no content
+                    // Parsed straight off the connection instead of through getString(). The rest of the body is
+                    // drained either way, which keeps the connection usable for the next request.
+                    ResponseStream body(client);
+                    DeserializationError e = DeserializationError::Ok;
+                    if (responseDoc) {
+                        e = filter ?
+                            deserializeJson(*responseDoc, body, DeserializationOption::Filter(*filter)) :
+                            deserializeJson(*responseDoc, body);
+                    }
+                    body.drain();
+                    DISCORD_LOGD(DISCORD_MESSAGE_PREFIX "Response body: %u bytes", static_cast<unsigned>(body.consumed()));
+                    if (e) {
+                        DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "deserializeJson() failed with code %s", e.c_str());
+                        return false;
+                    }
+                }
+                if (httpResponseCode == 401) {
+                    DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "401 Not Authorised.");
+                    return false;
+                }
+                return true;
             }
-            return true;
+
+            // Request failed
+            DISCORD_LOGE(DISCORD_MESSAGE_PREFIX "Error code: %d", httpResponseCode);
+            return false;
         }
+    }
 
-        // Request failed
-        Serial.print("[DISCORD] Error code: ");
-        Serial.println(httpResponseCode);
-        return false;
+    bool sendRest(
+        HTTPClient& client,
+        const char* method,
+        const char* uri,
+        const String& json,
+        const char* authorisationToken,
+        JsonDocument* responseDoc,
+        const JsonDocument* filter) {
+
+        prepareRest(client, method, uri, authorisationToken);
+        int httpResponseCode = json.isEmpty() ? client.sendRequest(method) : client.sendRequest(method, json);
+        return readRest(client, method, uri, httpResponseCode, responseDoc, filter);
+    }
+
+    bool sendRest(
+        HTTPClient& client,
+        const char* method,
+        const char* uri,
+        const JsonDocument& body,
+        const char* authorisationToken,
+        JsonDocument* responseDoc,
+        const JsonDocument* filter) {
+
+        prepareRest(client, method, uri, authorisationToken);
+        // Serialized onto the connection as it is sent, the body never exists as a whole.
+        RequestStream stream(body);
+        int httpResponseCode = client.sendRequest(method, &stream, stream.size());
+        return readRest(client, method, uri, httpResponseCode, responseDoc, filter);
     }
 }
\ No newline at end of file
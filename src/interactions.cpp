@@ -25,96 +25,136 @@
 #define DISCORD_INTERACTION_LOG_PREFIX "[DISCORD][COMMAND] "
 
 namespace Discord::Interactions {
-    uint64_t registerGlobalCommand(uint64_t applicationId, const ApplicationCommand& command, const char* botToken) {
-        StaticJsonDocument<1024> doc;
+    namespace {
+        // Runs a request on a client of its own, for callers without a connection to reuse.
+        template <typename R, typename F>
+        R withClient(F request) {
+            HTTPClient http;
+            http.begin(DISCORD_HOST, nullptr);
+            http.collectHeaders(ResponseStream::HEADERS, ResponseStream::HEADER_COUNT);
+            R result = request(http);
+            http.end();
+            return result;
+        }
+
+        uint64_t postCommand(HTTPClient& client, const char* url, const ApplicationCommand& command, const char* botToken) {
+            StaticJsonDocument<1024> doc;
+
+#ifdef _DISCORD_CLIENT_DEBUG
+            unsigned long start = micros();
+#endif
+            if (!serializeCommand(command, doc)) return 0;
+#ifdef _DISCORD_CLIENT_DEBUG
+            DISCORD_LOGD(DISCORD_INTERACTION_LOG_PREFIX "[PROFILE] Command serialized in (us): %lu, document: %u/1024b",
+                micros() - start, static_cast<unsigned>(doc.memoryUsage()));
+#endif
 
-        if (!serializeCommand(command, doc)) return 0;
+            StaticJsonDocument<JSON_OBJECT_SIZE(1)> filter;
+            filter["id"] = true;
+            StaticJsonDocument<64> response;
+            if (sendRest(client, "POST", url, doc, botToken, &response, &filter)) {
+                return response["id"];
+            }
+            return 0;
+        }
+    }
+
+    uint64_t registerGlobalCommand(uint64_t applicationId, const ApplicationCommand& command, const char* botToken) {
+        return withClient<uint64_t>([&](HTTPClient& client) {
+            return registerGlobalCommand(client, applicationId, command, botToken);
+            });
+    }
 
-        String url(DISCORD_HOST DISCORD_API_URI "/applications/");
+    uint64_t registerGlobalCommand(
+        HTTPClient& client, uint64_t applicationId, const ApplicationCommand& command, const char* botToken) {
+        RestPath url(DISCORD_API_URI "/applications/");
         url += applicationId;
         url += "/commands";
 
-        String json((char*)0);
-        json.reserve(1024);
-        serializeJson(doc, json);
-        HTTPClient _http;
-        _http.begin(url, nullptr);
-        StaticJsonDocument<512> response;
-        if (sendRest<512>(_http, "POST", url, json, botToken, &response)) {
-            uint64_t idString = response["id"];
-
-            Serial.print(DISCORD_INTERACTION_LOG_PREFIX "Global command ");
-            Serial.print(idString);
-            Serial.println(" registered.");
-            _http.end();
-            return idString;
+        uint64_t id = postCommand(client, url.c_str(), command, botToken);
+        if (id != 0) {
+            DISCORD_LOGI(DISCORD_INTERACTION_LOG_PREFIX "Global command %llu registered.",
+                static_cast<unsigned long long>(id));
         }
-        _http.end();
-        return 0;
+        return id;
     }
 
     uint64_t registerGuildCommand(uint64_t applicationId, const char* guildId, const ApplicationCommand& command, const char* botToken) {
-        StaticJsonDocument<1024> doc;
-
-        if (!serializeCommand(command, doc)) return 0;
+        return withClient<uint64_t>([&](HTTPClient& client) {
+            return registerGuildCommand(client, applicationId, guildId, command, botToken);
+            });
+    }
 
-        String url(DISCORD_HOST DISCORD_API_URI "/applications/");
+    uint64_t registerGuildCommand(HTTPClient& client,
+        uint64_t applicationId, const char* guildId, const ApplicationCommand& command, const char* botToken) {
+        RestPath url(DISCORD_API_URI "/applications/");
         url += applicationId;
         url += "/guilds/";
         url += guildId;
         url += "/commands";
 
-        String json((char*)0);
-        json.reserve(1024);
-        serializeJson(doc, json);
-        HTTPClient _http;
-        _http.begin(url, nullptr);
-        StaticJsonDocument<512> response;
-        if (sendRest<512>(_http, "POST", url, json, botToken, &response)) {
-            uint64_t idString = response["id"];
-
-            Serial.print(DISCORD_INTERACTION_LOG_PREFIX "[COMMAND] Guild command ");
-            Serial.print(idString);
-            Serial.println(" registered.");
-            _http.end();
-            return idString;
+        uint64_t id = postCommand(client, url.c_str(), command, botToken);
+        if (id != 0) {
+            DISCORD_LOGI(DISCORD_INTERACTION_LOG_PREFIX "Guild command %llu registered.",
+                static_cast<unsigned long long>(id));
         }
-        _http.end();
-        return 0;
+        return id;
     }
 
     bool deleteGlobalCommand(uint64_t applicationId, const String& commandId, const char* botToken) {
-        HTTPClient _http;
-        String url(DISCORD_HOST DISCORD_API_URI "/applications/");
+        return withClient<bool>([&](HTTPClient& client) {
+            return deleteGlobalCommand(client, applicationId, commandId, botToken);
+            });
+    }
+
+    bool deleteGlobalCommand(HTTPClient& client, uint64_t applicationId, const String& commandId, const char* botToken) {
+        RestPath url(DISCORD_API_URI "/applications/");
         url += applicationId;
         url += "/commands/";
-        url += commandId;
-        _http.begin(url);
+        url += commandId.c_str();
 
-        bool result = sendRest(_http, "DELETE", url, "", botToken);
-        _http.end();
-        return result;
+        return sendRest(client, "DELETE", url.c_str(), "", botToken);
     }
 
     bool deleteGuildCommand(
         uint64_t applicationId, const char* guildId, const String& commandId, const char* botToken) {
-        HTTPClient _http;
-        String url(DISCORD_HOST DISCORD_API_URI "/applications/");
+        return withClient<bool>([&](HTTPClient& client) {
+            return deleteGuildCommand(client, applicationId, guildId, commandId, botToken);
+            });
+    }
+
+    bool deleteGuildCommand(HTTPClient& client,
+        uint64_t applicationId, const char* guildId, const String& commandId, const char* botToken) {
+        RestPath url(DISCORD_API_URI "/applications/");
         url += applicationId;
         url += "/guilds/";
         url += guildId;
         url += "/commands/";
-        url += commandId;
-        _http.begin(url);
+        url += commandId.c_str();
+
+        return sendRest(client, "DELETE", url.c_str(), "", botToken);
+    }
+
+    uint64_t getApplicationId(const char* botToken) {
+        return withClient<uint64_t>([&](HTTPClient& client) {
+            return getApplicationId(client, botToken);
+            });
+    }
 
-        bool result = sendRest(_http, "DELETE", url, "", botToken);
-        _http.end();
-        return result;
+    uint64_t getApplicationId(HTTPClient& client, const char* botToken) {
+        StaticJsonDocument<JSON_OBJECT_SIZE(1)> filter;
+        filter["id"] = true;
+        StaticJsonDocument<64> response;
+        if (sendRest(client, "GET", DISCORD_API_URI "/oauth2/applications/@me", "", botToken, &response, &filter)) {
+            return response["id"];
+        }
+        DISCORD_LOGE(DISCORD_INTERACTION_LOG_PREFIX "Could not get the application ID.");
+        return 0;
     }
 
     bool serializeCommand(const ApplicationCommand& command, StaticJsonDocument<1024>& doc) {
         if (!strlen(command.name) || strlen(command.name) > 32) {
-            Serial.println(DISCORD_INTERACTION_LOG_PREFIX "Invalid name provided!");
+            DISCORD_LOGE(DISCORD_INTERACTION_LOG_PREFIX "Invalid name provided!");
             return false;
         }
         doc["name"] = command.name;
@@ -128,7 +168,7 @@ namespace Discord::Interactions {
                 JsonObject option_obj = options.createNestedObject();
                 ApplicationCommand::Option& option = command.options[i];
                 if (!strlen(option.name) || strlen(option.name) > 32) {
-                    Serial.println(DISCORD_INTERACTION_LOG_PREFIX "Invalid option name provided!");
+                    DISCORD_LOGE(DISCORD_INTERACTION_LOG_PREFIX "Invalid option name provided!");
                     return false;
                 }
 
@@ -136,6 +176,19 @@ namespace Discord::Interactions {
                 option_obj["description"] = option.description;
                 option_obj["type"] = static_cast<int>(option.type);
                 option_obj["required"] = option.required;
+                if (option.autocomplete) {
+                    if (option.choicesLength > 0) {
+                        DISCORD_LOGE(DISCORD_INTERACTION_LOG_PREFIX "Autocomplete cannot be used with choices!");
+                        return false;
+                    }
+                    if (option.type != ApplicationCommand::OptionType::STRING &&
+                        option.type != ApplicationCommand::OptionType::INTEGER &&
+                        option.type != ApplicationCommand::OptionType::NUMBER) {
+                        DISCORD_LOGE(DISCORD_INTERACTION_LOG_PREFIX "Invalid option type provided with autocomplete!");
+                        return false;
+                    }
+                    option_obj["autocomplete"] = true;
+                }
 
                 if (option.choicesLength > 0) {
                     JsonArray choice_array = option_obj.createNestedArray("choices");
@@ -144,7 +197,7 @@ namespace Discord::Interactions {
                         JsonObject choice_obj = choice_array.createNestedObject();
                         ApplicationCommand::Option::Choice& choice = option.choices[i];
                         if (!strlen(choice.name) || strlen(choice.name) > 32) {
-                            Serial.println(DISCORD_INTERACTION_LOG_PREFIX "Invalid option choice name provided!");
+                            DISCORD_LOGE(DISCORD_INTERACTION_LOG_PREFIX "Invalid option choice name provided!");
                             return false;
                         }
 
@@ -161,7 +214,7 @@ namespace Discord::Interactions {
                                 choice_obj["value"] = choice.doubleValue;
                                 break;
                             default:
-                                Serial.println(DISCORD_INTERACTION_LOG_PREFIX "Invalid option type provided with choice!");
+                                DISCORD_LOGE(DISCORD_INTERACTION_LOG_PREFIX "Invalid option type provided with choice!");
                                 break;
                         }
                     }
@@ -0,0 +1,113 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <ledstatus.h>
+
+namespace {
+#ifdef ESP32
+    void tick(TimerHandle_t timer) {
+        static_cast<LedStatus*>(pvTimerGetTimerID(timer))->update();
+    }
+#endif
+
+    uint32_t scale(uint32_t colour, uint32_t level) {
+        uint32_t r = ((colour >> 16) & 0xFF) * level / 255;
+        uint32_t g = ((colour >> 8) & 0xFF) * level / 255;
+        uint32_t b = (colour & 0xFF) * level / 255;
+        return (r << 16) | (g << 8) | b;
+    }
+}
+
+bool LedStatus::begin() {
+#ifdef ESP32
+    TimerHandle_t timer = xTimerCreate("LedStatus", pdMS_TO_TICKS(LED_TICK), pdTRUE, this, tick);
+    return timer != nullptr && xTimerStart(timer, 0) == pdPASS;
+#else
+    return false;
+#endif
+}
+
+void LedStatus::set(Layer layer, uint32_t colour, Mode mode, unsigned long duration) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    Request& request = _layers[static_cast<size_t>(layer)];
+    // Repeating a standing request keeps its animation in phase.
+    if (request.active && request.duration == 0 && duration == 0 && request.colour == colour && request.mode == mode) return;
+
+    request.colour = colour;
+    request.mode = mode;
+    request.since = millis();
+    request.duration = duration;
+    request.active = true;
+    _dirty = true;
+}
+
+void LedStatus::clear(Layer layer) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    Request& request = _layers[static_cast<size_t>(layer)];
+    if (!request.active) return;
+    request.active = false;
+    _dirty = true;
+}
+
+uint32_t LedStatus::render(const Request& request, unsigned long now) {
+    unsigned long elapsed = now - request.since;
+    switch (request.mode) {
+        case Mode::Blink:
+            return elapsed % LED_BLINK_PERIOD < LED_BLINK_PERIOD / 2 ? request.colour : 0;
+        case Mode::Fade: {
+            // Triangle wave, full brightness at the start of each cycle.
+            uint32_t phase = elapsed % LED_FADE_PERIOD;
+            uint32_t half = LED_FADE_PERIOD / 2;
+            uint32_t level = phase < half ? 255 - phase * 255 / half : (phase - half) * 255 / half;
+            return scale(request.colour, level);
+        }
+        default:
+            return request.colour;
+    }
+}
+
+void LedStatus::update() {
+    uint32_t colour = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        unsigned long now = millis();
+        const Request* top = nullptr;
+        for (Request& request : _layers) {
+            if (request.active && request.duration > 0 && now - request.since >= request.duration) {
+                request.active = false;
+                _dirty = true;
+            }
+            if (request.active) {
+                top = &request;
+            }
+        }
+        if (!_dirty) return;
+
+        if (top != nullptr) {
+            colour = render(*top, now);
+            // Animations keep changing without any new request.
+            _dirty = top->mode != Mode::Solid;
+        }
+        else {
+            _dirty = false;
+        }
+        if (colour == _written) return;
+        _written = colour;
+    }
+    _writer(colour);
+}
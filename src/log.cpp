@@ -0,0 +1,139 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <stdarg.h>
+
+#include <log.h>
+#include <stacksize.h>
+
+static_assert((DISCORD_LOG_SLOTS & (DISCORD_LOG_SLOTS - 1)) == 0, "DISCORD_LOG_SLOTS must be a power of two.");
+
+namespace Discord::Log {
+    namespace {
+        // Bounded multi-producer queue: each slot's sequence tells producers when it is free to fill,
+        // and the single consumer when it is ready to read. Sequences are stored relative to the slot index,
+        // so the zero-initialised buffer is already valid before any constructor runs.
+        struct Slot {
+            std::atomic<uint32_t> sequence;
+            Level level;
+            char text[DISCORD_LOG_LINE_LENGTH];
+        };
+
+        Slot slots[DISCORD_LOG_SLOTS];
+        std::atomic<uint32_t> head { 0 };
+        uint32_t tail = 0;
+        std::atomic<uint32_t> droppedLines { 0 };
+        Print* output = nullptr;
+
+        const char LEVEL_TAGS[] = { ' ', 'E', 'W', 'I', 'D', 'V' };
+
+        inline uint32_t sequenceOf(const Slot& slot, uint32_t position) {
+            return slot.sequence.load(std::memory_order_acquire) + position % DISCORD_LOG_SLOTS;
+        }
+
+        inline void setSequence(Slot& slot, uint32_t position, uint32_t sequence) {
+            slot.sequence.store(sequence - position % DISCORD_LOG_SLOTS, std::memory_order_release);
+        }
+
+#ifdef ESP32
+        const uint32_t DRAIN_TASK_STACK = 2048;
+        // Flushes between stack measurements, which have to scan the stack.
+        const unsigned int STACK_CHECK_FLUSHES = 50;
+
+        void drainTask(void* parameter) {
+            uint32_t allocated = reinterpret_cast<uintptr_t>(parameter);
+            for (unsigned int flushes = 1;; ++flushes) {
+                flush();
+                if (flushes % STACK_CHECK_FLUSHES == 0) {
+                    Stack::record(Stack::Task::Log, allocated, uxTaskGetStackHighWaterMark(NULL));
+                }
+                vTaskDelay(pdMS_TO_TICKS(20));
+            }
+        }
+#endif
+    }
+
+    void begin(Print& sink, unsigned int priority) {
+        output = &sink;
+#ifdef ESP32
+        uint32_t stack = Stack::size(Stack::Task::Log, DRAIN_TASK_STACK);
+        xTaskCreate(drainTask, "DiscordLog", stack, reinterpret_cast<void*>(static_cast<uintptr_t>(stack)), priority, nullptr);
+#endif
+    }
+
+    void write(Level level, const char* format, ...) {
+        uint32_t position = head.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &slots[position % DISCORD_LOG_SLOTS];
+            uint32_t sequence = sequenceOf(*slot, position);
+            int32_t difference = static_cast<int32_t>(sequence - position);
+            if (difference == 0) {
+                if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            }
+            else if (difference < 0) {
+                // Full. Dropping keeps the caller from ever waiting on the sink.
+                droppedLines.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+
+        slot->level = level;
+        va_list args;
+        va_start(args, format);
+        vsnprintf(slot->text, sizeof(slot->text), format, args);
+        va_end(args);
+        setSequence(*slot, position, position + 1);
+    }
+
+    size_t flush() {
+        if (output == nullptr) return 0;
+
+        size_t written = 0;
+        static uint32_t lastDropped = 0;
+        for (;;) {
+            Slot& slot = slots[tail % DISCORD_LOG_SLOTS];
+            if (static_cast<int32_t>(sequenceOf(slot, tail) - (tail + 1)) < 0) break;
+
+            if (slot.level == Level::Error || slot.level == Level::Warn) {
+                output->print(LEVEL_TAGS[static_cast<uint8_t>(slot.level)]);
+                output->print(' ');
+            }
+            output->println(slot.text);
+            setSequence(slot, tail, tail + DISCORD_LOG_SLOTS);
+            ++tail;
+            ++written;
+        }
+
+        uint32_t droppedNow = dropped();
+        if (droppedNow != lastDropped) {
+            output->print("[LOG] Lines dropped: ");
+            output->println(droppedNow - lastDropped);
+            lastDropped = droppedNow;
+        }
+        return written;
+    }
+
+    uint32_t dropped() {
+        return droppedLines.load(std::memory_order_relaxed);
+    }
+}
@@ -18,13 +18,24 @@
 
 #include <Arduino.h>
 #include <M5Atom.h>
+#include <StreamString.h>
+#include <WebServer.h>
 #include <WiFiMulti.h>
 #include <WiFiUdp.h>
 #include <WakeOnLan.h>
 
 #include <discord.h>
 #include <interactions.h>
+#include <ledstatus.h>
+#include <log.h>
+#include <metrics.h>
+#include <prefixindex.h>
+// Builds other than the device's, such as the native tests, bring a configuration of their own.
+#ifdef DISCORD_PRIVATECONFIG
+#include DISCORD_PRIVATECONFIG
+#else
 #include <privateconfig.h>
+#endif
 
  // LED Colors
 #define WHITE  0xFFFFFF //Standby
@@ -35,7 +46,8 @@
 #define AMBER  0xFF4000 //Executing command
 #define OFF    0x000000
 
-#define LOGIN_INTERVAL 30000 //Cannot be too short to give time to initially retrieve the gateway API
+#define STATS_PORT 80 //Serves Prometheus metrics on /metrics, and interactions on /interactions when a public key is set
+#define NTP_SERVER "pool.ntp.org" //Sets the wall clock, for timing interactions from their creation
 
 // This sets Arduino Stack Size - comment this line to use default 8K stack size
 //SET_LOOP_TASK_STACK_SIZE(16 * 1024); // 16KB
@@ -43,12 +55,26 @@
 WiFiMulti wifiMulti;
 WiFiUDP UDP;
 WakeOnLan WOL(UDP);
+WebServer statsServer(STATS_PORT);
 
 Discord::Bot discord(botToken);
+// Only called by the LED status timer, and only when the colour changes.
+void write_led(uint32_t colour) {
+    M5.dis.drawpix(0, colour);
+}
+LedStatus led(write_led);
+// Target names offered while typing /wake.
+Discord::PrefixIndex<sizeof(wakeTargets) / sizeof(wakeTargets[0])> wakeTargetIndex;
 
 bool botEnabled = true;
 bool broadcastAddrSet = false;
-unsigned long lastLoginAttempt = 0;
+bool statsServerStarted = false;
+// Interactions are POSTed to /interactions instead of arriving over the gateway, which is not connected.
+bool endpointMode = false;
+// Request headers the web server keeps, for verifying interactions and authorising LAN wakes.
+const char* requestHeaders[] = { "X-Signature-Ed25519", "X-Signature-Timestamp", "Authorization" };
+bool ledTimerStarted = false;
+unsigned long lastStackCheck = 0;
 
 bool update_wifi_status() {
     if (wifiMulti.run() == WL_CONNECTED) {
@@ -56,11 +82,11 @@ bool update_wifi_status() {
 
         // Attention: 255.255.255.255 is denied in some networks
         IPAddress broadcastAddr = WOL.calculateBroadcastAddress(WiFi.localIP(), WiFi.subnetMask());
-        Serial.print("[WIFI] Broadcast address set to ");
-        broadcastAddr.printTo(Serial);
-        Serial.println();
+        DISCORD_LOGI("[WIFI] Broadcast address set to %s", broadcastAddr.toString().c_str());
         broadcastAddrSet = true;
-        Serial.println("[WIFI] Wi-Fi connection established.");
+        DISCORD_LOGI("[WIFI] Wi-Fi connection established.");
+        // UTC, only used for timestamps. SNTP keeps resyncing in the background from here.
+        configTime(0, 0, NTP_SERVER);
 
         return true;
     }
@@ -68,8 +94,101 @@ bool update_wifi_status() {
     return false;
 }
 
-void on_discord_interaction(const char* name, const JsonObject& interaction) {
-    M5.dis.drawpix(0, PURPLE);
+void handle_metrics_request() {
+    StreamString body;
+    body.reserve(4096);
+    Discord::Metrics::writePrometheus(body);
+    statsServer.send(200, "text/plain; version=0.0.4", body);
+}
+
+void handle_interaction_request() {
+    if (!botEnabled) {
+        statsServer.send(503, "text/plain", "Bot disabled.");
+        return;
+    }
+    // A copy of its own, the bot parses it in place.
+    String body = statsServer.arg("plain");
+    String reply;
+    int status = discord.receiveInteraction(statsServer.header("X-Signature-Ed25519").c_str(),
+        statsServer.header("X-Signature-Timestamp").c_str(), body.begin(), body.length(), reply);
+    statsServer.send(status, "application/json", reply);
+}
+
+bool is_bot_owner(uint64_t id) {
+    for (size_t i = 0; i < sizeof(botOwnerIds) / sizeof(botOwnerIds[0]); ++i) {
+        if (id == botOwnerIds[i]) return true;
+    }
+    return false;
+}
+
+const WakeTarget* find_wake_target(const char* name) {
+    if (name == nullptr || strlen(name) == 0) return &wakeTargets[0];
+    for (const WakeTarget& target : wakeTargets) {
+        if (strcasecmp(target.name, name) == 0) return &target;
+    }
+    return nullptr;
+}
+
+// Shared by /wake, the LAN endpoint and the button.
+bool wake_target(const WakeTarget& target) {
+    if (WOL.sendMagicPacket(target.macAddress)) {
+        DISCORD_LOGI("[WOL] Packet sent to %s.", target.name);
+        return true;
+    }
+    DISCORD_LOGE("[WOL] Packet failed to send to %s.", target.name);
+    led.set(LedStatus::Layer::Error, RED, LedStatus::Mode::Blink, 3000);
+    return false;
+}
+
+// Compares every character whatever the input, so the time taken does not give away how much of a guess matched.
+bool is_lan_token(const String& authorization) {
+    static const char prefix[] = "Bearer ";
+    size_t expected = strlen(lanToken);
+    if (expected == 0 || authorization.length() != sizeof(prefix) - 1 + expected ||
+        !authorization.startsWith(prefix)) return false;
+
+    const char* given = authorization.c_str() + sizeof(prefix) - 1;
+    uint8_t difference = 0;
+    for (size_t i = 0; i < expected; ++i) {
+        difference |= given[i] ^ lanToken[i];
+    }
+    return difference == 0;
+}
+
+// POST /wake?target=<name>, with the header "Authorization: Bearer <lanToken>". Answers without going through Discord,
+// so it keeps working while the uplink is down.
+void handle_wake_request() {
+    if (!is_lan_token(statsServer.header("Authorization"))) {
+        DISCORD_LOGW("[LAN] Wake refused, bad token from %s.", statsServer.client().remoteIP().toString().c_str());
+        statsServer.send(401, "text/plain", "Access denied.\n");
+        return;
+    }
+    const WakeTarget* target = find_wake_target(statsServer.arg("target").c_str());
+    if (target == nullptr) {
+        statsServer.send(404, "text/plain", "Unknown target.\n");
+        return;
+    }
+    led.set(LedStatus::Layer::Activity, AMBER, LedStatus::Mode::Solid, 500);
+    if (wake_target(*target)) {
+        statsServer.send(200, "text/plain", String("Wake packet sent to ") + target->name + ".\n");
+    }
+    else {
+        statsServer.send(500, "text/plain", "Wake packet failed to send.\n");
+    }
+}
+
+void on_discord_autocomplete(
+    const char* command, const char* option, const char* value, const Discord::Bot::Interaction& interaction) {
+    const char* matches[DISCORD_AUTOCOMPLETE_CHOICES_MAX];
+    size_t found = 0;
+    if (strcmp(command, "wake") == 0 && strcmp(option, "target") == 0 && is_bot_owner(interaction.user.id)) {
+        found = wakeTargetIndex.find(value, matches, DISCORD_AUTOCOMPLETE_CHOICES_MAX);
+    }
+    discord.sendAutocompleteResult(matches, found);
+}
+
+void on_discord_interaction(const char* name, const Discord::Bot::Interaction& interaction) {
+    led.set(LedStatus::Layer::Activity, PURPLE, LedStatus::Mode::Blink, 1000);
 
     if (strcmp(name, "ping") == 0) {
         Discord::Bot::MessageResponse response;
@@ -88,42 +207,57 @@ void on_discord_interaction(const char* name, const JsonObject& interaction) {
     }
     else if (strcmp(name, "wake") == 0) {
         Discord::Bot::MessageResponse response;
-        uint64_t id;
-        if (interaction.containsKey("member")) {
-            id = interaction["member"]["user"]["id"];
+
+        const WakeTarget* target = find_wake_target(interaction.option("target").as<const char*>());
+        if (!is_bot_owner(interaction.user.id)) {
+            response.content = "Access denied.";
+            response.flags = Discord::Bot::MessageResponse::Flags::EPHEMERAL;
+            discord.sendCommandResponse(Discord::Bot::InteractionResponse::CHANNEL_MESSAGE_WITH_SOURCE, response);
         }
-        else {
-            id = interaction["user"]["id"];
+        else if (target == nullptr) {
+            response.content = "Unknown target.";
+            response.flags = Discord::Bot::MessageResponse::Flags::EPHEMERAL;
+            discord.sendCommandResponse(Discord::Bot::InteractionResponse::CHANNEL_MESSAGE_WITH_SOURCE, response);
         }
-
-        bool authorised = false;
-        for (int i = 0; i < sizeof(botOwnerIds) / sizeof(botOwnerIds[0]); ++i) {
-            if (id != botOwnerIds[i]) continue;
-
-            authorised = true;
-            response.content = "Command acknowledged. Initiating remote wake sequence.";
+        else {
+            char msg[96];
+            snprintf(msg, sizeof(msg), "Command acknowledged. Initiating remote wake sequence for %s.", target->name);
+            response.content = msg;
             discord.sendCommandResponse(Discord::Bot::InteractionResponse::CHANNEL_MESSAGE_WITH_SOURCE, response);
-            if (WOL.sendMagicPacket(macAddress)) {
-                Serial.println("[WOL] Packet sent.");
-            }
-            else {
-                Serial.println("[WOL] Packet failed to send.");
-                M5.dis.drawpix(0, RED);
+            if (wake_target(*target)) {
+                Discord::Metrics::registry.interactionWake.observe(millis() - discord.interactionReceived());
             }
         }
+    }
+    else if (strcmp(name, "stats") == 0) {
+        Discord::Bot::MessageResponse response;
+        response.flags = Discord::Bot::MessageResponse::Flags::EPHEMERAL;
 
-        if (!authorised) {
+        StreamString summary;
+        if (is_bot_owner(interaction.user.id)) {
+            summary.reserve(512);
+            Discord::Metrics::writeSummary(summary);
+            response.content = summary.c_str();
+        }
+        else {
             response.content = "Access denied.";
-            response.flags = Discord::Bot::MessageResponse::Flags::EPHEMERAL;
-            discord.sendCommandResponse(Discord::Bot::InteractionResponse::CHANNEL_MESSAGE_WITH_SOURCE, response);
         }
+        discord.sendCommandResponse(Discord::Bot::InteractionResponse::CHANNEL_MESSAGE_WITH_SOURCE, response);
     }
-
-    vTaskDelay(500);
 }
 
-void registerCommands() {
-    Serial.println("Registering commands...");
+// Runs on the bot's REST client, so every command goes over one connection and one TLS handshake.
+void registerCommands(HTTPClient& client) {
+    DISCORD_LOGI("Registering commands...");
+    uint64_t applicationId = discord.applicationId();
+    if (applicationId == 0) {
+        // Only known from READY, so looked up when interactions come from the endpoint instead.
+        applicationId = Discord::Interactions::getApplicationId(client, botToken);
+        if (applicationId == 0) {
+            DISCORD_LOGE("Application ID unknown, commands not registered.");
+            return;
+        }
+    }
     Discord::Interactions::ApplicationCommand cmd;
     // 1. /ping
     cmd.name = "ping";
@@ -131,13 +265,12 @@ void registerCommands() {
     cmd.description = "Ping the bot for a response.";
     cmd.default_member_permissions = 2147483648; //Use Application Commands
 
-    uint64_t id = Discord::Interactions::registerGlobalCommand(discord.applicationId(), cmd, botToken);
+    uint64_t id = Discord::Interactions::registerGlobalCommand(client, applicationId, cmd, botToken);
     if (id == 0) {
-        Serial.println("Command registration failed!");
+        DISCORD_LOGE("Command registration failed!");
     }
     else {
-        Serial.print("Registered ping command to id ");
-        Serial.println(id);
+        DISCORD_LOGI("Registered ping command to id %llu", static_cast<unsigned long long>(id));
     }
 
     //2. /wake
@@ -145,14 +278,38 @@ void registerCommands() {
     cmd.type = Discord::Interactions::CommandType::CHAT_INPUT;
     cmd.description = "Send a wake signal to the main terminal. Authorized users only.";
     cmd.default_member_permissions = 2147483648;
+    Discord::Interactions::ApplicationCommand::Option target;
+    target.name = "target";
+    target.description = "The machine to wake, defaults to the main terminal.";
+    target.type = Discord::Interactions::ApplicationCommand::OptionType::STRING;
+    target.required = false;
+    target.choices = nullptr;
+    target.autocomplete = true;
+    cmd.options = &target;
+    cmd.optionsLength = 1;
+
+    id = Discord::Interactions::registerGlobalCommand(client, applicationId, cmd, botToken);
+    if (id == 0) {
+        DISCORD_LOGE("Command registration failed!");
+    }
+    else {
+        DISCORD_LOGI("Registered wake command to id %llu", static_cast<unsigned long long>(id));
+    }
 
-    id = Discord::Interactions::registerGlobalCommand(discord.applicationId(), cmd, botToken);
+    //3. /stats
+    cmd.name = "stats";
+    cmd.type = Discord::Interactions::CommandType::CHAT_INPUT;
+    cmd.description = "Show runtime statistics. Authorized users only.";
+    cmd.default_member_permissions = 2147483648;
+    cmd.options = nullptr;
+    cmd.optionsLength = 0;
+
+    id = Discord::Interactions::registerGlobalCommand(client, applicationId, cmd, botToken);
     if (id == 0) {
-        Serial.println("Command registration failed!");
+        DISCORD_LOGE("Command registration failed!");
     }
     else {
-        Serial.print("Registered wake command to id ");
-        Serial.println(id);
+        DISCORD_LOGI("Registered stats command to id %llu", static_cast<unsigned long long>(id));
     }
 }
 
@@ -163,107 +320,133 @@ void setup() {
     // Clear the serial port buffer and set the serial port baud rate to 115200.
     // Do not Initialize I2C. Initialize the LED matrix.
     M5.begin(true, false, true);
-    M5.dis.drawpix(0, WHITE);
-    Serial.print("[CONFIG] Target MAC address set to ");
-    Serial.println(macAddress);
-    Serial.print("[CONFIG] Default network set to ");
-    Serial.println(wifiSSID);
+    led.set(LedStatus::Layer::Connection, WHITE);
+    ledTimerStarted = led.begin();
+    Discord::Log::begin(Serial);
+    for (const WakeTarget& target : wakeTargets) {
+        wakeTargetIndex.add(target.name);
+        DISCORD_LOGI("[CONFIG] Target %s set to MAC address %s", target.name, target.macAddress);
+    }
+    DISCORD_LOGI("[CONFIG] Default network set to %s", wifiSSID);
     wifiMulti.addAP(wifiSSID, wifiPassword);
 
     discord.onInteraction(on_discord_interaction);
+    discord.onAutocomplete(on_discord_autocomplete);
+    statsServer.on("/metrics", HTTP_GET, handle_metrics_request);
+    if (strlen(publicKey) > 0 && discord.setPublicKey(publicKey)) {
+        endpointMode = true;
+        statsServer.on("/interactions", HTTP_POST, handle_interaction_request);
+        DISCORD_LOGI("[CONFIG] Interactions received on /interactions, the gateway is not used.");
+    }
+    if (strlen(lanToken) > 0) {
+        statsServer.on("/wake", HTTP_POST, handle_wake_request);
+        DISCORD_LOGI("[CONFIG] LAN wakes accepted on /wake.");
+    }
+    statsServer.collectHeaders(requestHeaders, sizeof(requestHeaders) / sizeof(requestHeaders[0]));
+    if (!ledTimerStarted) {
+        DISCORD_LOGW("[LED] Timer not started, updating from the loop instead.");
+    }
 }
 
 #ifdef _DISCORD_CLIENT_DEBUG
 long lastStackValue = 0;
-long lastStackCheck = 0;
 long lastHeapValue = 0;
 #endif
 
 void loop() {
     M5.update();
+    if (!ledTimerStarted) {
+        led.update();
+    }
     // put your main code here, to run repeatedly:
     unsigned long now = millis();
 
     //Current record:
     //Loop() - Free Stack Space: 3132
-#ifdef _DISCORD_CLIENT_DEBUG
     if (now - lastStackCheck >= 2000) {
-        // Print unused stack for the task that is running loop()
+        // Track unused stack for the task that is running loop()
         long currentStack = uxTaskGetStackHighWaterMark(NULL);
+        Discord::Metrics::registry.loopStackHighWater.setMin(currentStack);
+        // Keeps what the library's tasks have used, so their stacks are sized from it after a reboot.
+        Discord::Stack::save();
+#ifdef _DISCORD_CLIENT_DEBUG
         if (currentStack != lastStackValue) {
-            Serial.print("[STACK CHANGE] Loop() - Free Stack Space: ");
-            Serial.print(currentStack);
-            Serial.print(" (");
-            Serial.print(currentStack - lastStackValue);
-            Serial.println(")");
+            DISCORD_LOGD("[STACK CHANGE] Loop() - Free Stack Space: %ld (%ld)", currentStack, currentStack - lastStackValue);
             lastStackValue = currentStack;
         }
         long currentFree = esp_get_free_heap_size();
         if (currentFree != lastHeapValue) {
-            Serial.print("[HEAP CHANGE] - Free Heap Space: ");
-            Serial.print(currentFree);
-            Serial.print(" (");
-            Serial.print(currentFree - lastHeapValue);
-            Serial.println(")");
+            DISCORD_LOGD("[HEAP CHANGE] - Free Heap Space: %ld (%ld)", currentFree, currentFree - lastHeapValue);
             lastHeapValue = currentFree;
         }
+#endif
         lastStackCheck = now;
     }
-#endif
 
     if (!update_wifi_status()) {
-        M5.dis.drawpix(0, RED);
-        Serial.println("[WIFI] Wi-Fi connection not established.");
+        led.set(LedStatus::Layer::Connection, RED);
+        DISCORD_LOGW("[WIFI] Wi-Fi connection not established.");
         vTaskDelay(1000);
         return;
     }
 
-    if (botEnabled) {
-        if (!discord.online()) {
-            M5.dis.drawpix(0, PURPLE);
-            if (now > lastLoginAttempt) {
-                lastLoginAttempt = now + LOGIN_INTERVAL;
-                discord.login(4096); // DIRECT_MESSAGES
-            }
+    if (!statsServerStarted) {
+        statsServer.begin();
+        statsServerStarted = true;
+        DISCORD_LOGI("[STATS] Metrics served on port %d", STATS_PORT);
+    }
+    statsServer.handleClient();
+
+    if (botEnabled && endpointMode) {
+        // Ready whenever the server is, interactions arrive through handleClient() above.
+        led.set(LedStatus::Layer::Connection, GREEN);
+    }
+    else if (botEnabled) {
+        if (!discord.active()) {
+            // The bot reconnects by itself from here on, until logged out.
+            // Only interactions are handled, and those need no intents.
+            discord.login();
+        }
+        // Repeated requests are ignored by the LED, so these cost nothing while the state holds.
+        if (discord.state() != Discord::Bot::ConnectionState::Ready) {
+            led.set(LedStatus::Layer::Connection, PURPLE, LedStatus::Mode::Fade);
         }
         else {
-            M5.dis.drawpix(0, GREEN);
+            led.set(LedStatus::Layer::Connection, GREEN);
         }
         discord.update(now);
     }
     else {
-        M5.dis.drawpix(0, BLUE);
+        led.set(LedStatus::Layer::Connection, BLUE);
     }
 
     if (M5.Btn.pressedFor(5000)) {
-        M5.dis.drawpix(0, AMBER);
+        led.set(LedStatus::Layer::Button, AMBER);
     }
     else if (M5.Btn.pressedFor(2500)) {
-        M5.dis.drawpix(0, PURPLE);
+        led.set(LedStatus::Layer::Button, PURPLE);
+    }
+    else {
+        led.clear(LedStatus::Layer::Button);
     }
     if (M5.Btn.wasReleasefor(5000)) {
         botEnabled = !botEnabled;
 
-        if (!botEnabled && discord.online()) {
+        if (!botEnabled && discord.active()) {
             discord.logout();
         }
     }
     else if (M5.Btn.wasReleasefor(2500)) {
         if (!botEnabled) {
-            Serial.println("Bot offline, command update not performed.");
+            DISCORD_LOGW("Bot offline, command update not performed.");
         }
         else {
-            registerCommands();
+            discord.withRestClient(registerCommands);
         }
     }
     else if (M5.Btn.wasReleased()) {
-        if (WOL.sendMagicPacket(macAddress)) {
-            Serial.println("[WOL] Packet sent.");
-            M5.dis.drawpix(0, AMBER);
-        }
-        else {
-            Serial.println("[WOL] Packet failed to send.");
-            M5.dis.drawpix(0, RED);
+        if (wake_target(wakeTargets[0])) {
+            led.set(LedStatus::Layer::Activity, AMBER, LedStatus::Mode::Solid, 500);
         }
         vTaskDelay(100);
     }
@@ -0,0 +1,332 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <discord.h>
+#include <metrics.h>
+#include <stacksize.h>
+
+#ifdef ESP32
+#include <esp_heap_caps.h>
+#endif
+
+namespace Discord::Metrics {
+    Registry registry;
+
+    constexpr uint32_t Histogram::BOUNDS[];
+
+    namespace {
+        const char* const DISPATCH_NAMES[Registry::DISPATCH_COUNT] = {
+            "READY", "RESUMED", "INTERACTION_CREATE", "MESSAGE_CREATE", "OTHER"
+        };
+
+        uint32_t largestFreeBlock() {
+#ifdef ESP32
+            return heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+#else
+            return 0;
+#endif
+        }
+
+        uint32_t minimumFreeHeap() {
+#ifdef ESP32
+            return esp_get_minimum_free_heap_size();
+#else
+            return 0;
+#endif
+        }
+
+        void writeMetric(Print& out, const char* name, const char* type, const char* help) {
+            out.print("# HELP ");
+            out.print(name);
+            out.print(' ');
+            out.println(help);
+            out.print("# TYPE ");
+            out.print(name);
+            out.print(' ');
+            out.println(type);
+        }
+
+        void writeValue(Print& out, const char* name, uint32_t value) {
+            out.print(name);
+            out.print(' ');
+            out.println(value);
+        }
+
+        void writeHistogram(Print& out, const char* name, const char* help, const Histogram& histogram) {
+            writeMetric(out, name, "histogram", help);
+            uint32_t cumulative = 0;
+            for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+                cumulative += histogram.bucket(i);
+                out.print(name);
+                out.print("_bucket{le=\"");
+                if (i < Histogram::BUCKETS - 1) {
+                    out.print(Histogram::BOUNDS[i]);
+                }
+                else {
+                    out.print("+Inf");
+                }
+                out.print("\"} ");
+                out.println(cumulative);
+            }
+            out.print(name);
+            out.print("_sum ");
+            out.println(histogram.sum());
+            out.print(name);
+            out.print("_count ");
+            out.println(histogram.count());
+        }
+
+        void writeLatencySummary(Print& out, const char* label, const Histogram& histogram) {
+            out.print(label);
+            out.print(": ");
+            out.print(histogram.count());
+            out.print(" samples, p50 ");
+            out.print(histogram.percentile(0.5f));
+            out.print("ms, p99 ");
+            out.print(histogram.percentile(0.99f));
+            out.print("ms, max ");
+            out.print(histogram.maxObserved());
+            out.println("ms");
+        }
+    }
+
+    void Gauge::setMin(uint32_t value) {
+        uint32_t current = _value.load(std::memory_order_relaxed);
+        while ((current == 0 || value < current) &&
+            !_value.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+
+    void Histogram::observe(uint32_t ms) {
+        size_t i = 0;
+        while (i < BUCKETS - 1 && ms > BOUNDS[i]) ++i;
+        _buckets[i].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(ms, std::memory_order_relaxed);
+
+        uint32_t current = _max.load(std::memory_order_relaxed);
+        while (ms > current && !_max.compare_exchange_weak(current, ms, std::memory_order_relaxed)) {}
+    }
+
+    uint32_t Histogram::percentile(float q) const {
+        uint32_t total = count();
+        if (total == 0) return 0;
+
+        uint32_t rank = static_cast<uint32_t>(q * total + 0.5f);
+        if (rank == 0) rank = 1;
+        uint32_t cumulative = 0;
+        for (size_t i = 0; i < BUCKETS - 1; ++i) {
+            cumulative += bucket(i);
+            if (cumulative >= rank) return std::min(BOUNDS[i], maxObserved());
+        }
+        return maxObserved();
+    }
+
+    void Registry::recordRestStatus(int code) {
+        if (code <= 0 || code >= 600) {
+            restResponses[0].increment();
+            return;
+        }
+        restResponses[code / 100].increment();
+        if (code == 429) {
+            restRateLimited.increment();
+        }
+    }
+
+    void Registry::recordRestConnection(bool reused) {
+        if (reused) {
+            restConnectionsReused.increment();
+        }
+        else {
+            restConnectionsOpened.increment();
+        }
+    }
+
+    void Registry::recordOpcode(int op) {
+        if (op >= 0 && op < static_cast<int>(OPCODES)) {
+            opcodes[op].increment();
+        }
+    }
+
+    void Registry::recordDispatch(const char* name) {
+        if (name == nullptr) return;
+        for (size_t i = 0; i < OTHER; ++i) {
+            if (strcmp(name, DISPATCH_NAMES[i]) == 0) {
+                dispatches[i].increment();
+                return;
+            }
+        }
+        dispatches[OTHER].increment();
+    }
+
+    void writePrometheus(Print& out) {
+        writeMetric(out, "discord_uptime_seconds", "gauge", "Time since boot.");
+        writeValue(out, "discord_uptime_seconds", millis() / 1000);
+        writeMetric(out, "discord_heap_free_bytes", "gauge", "Free heap.");
+        writeValue(out, "discord_heap_free_bytes", freeHeap());
+        writeMetric(out, "discord_heap_min_free_bytes", "gauge", "Lowest free heap since boot.");
+        writeValue(out, "discord_heap_min_free_bytes", minimumFreeHeap());
+        writeMetric(out, "discord_heap_largest_free_block_bytes", "gauge", "Largest allocatable heap block.");
+        writeValue(out, "discord_heap_largest_free_block_bytes", largestFreeBlock());
+
+        writeMetric(out, "discord_stack_high_water_bytes", "gauge", "Lowest unused stack seen per task.");
+        out.print("discord_stack_high_water_bytes{task=\"loop\"} ");
+        out.println(registry.loopStackHighWater.value());
+        out.print("discord_stack_high_water_bytes{task=\"post\"} ");
+        out.println(registry.postTaskStackHighWater.value());
+
+        writeMetric(out, "discord_stack_used_max_bytes", "gauge", "Most stack a library task has used, kept across reboots.");
+        out.print("discord_stack_used_max_bytes{task=\"post\"} ");
+        out.println(Stack::observed(Stack::Task::Post));
+        out.print("discord_stack_used_max_bytes{task=\"log\"} ");
+        out.println(Stack::observed(Stack::Task::Log));
+
+        writeMetric(out, "discord_json_arena_high_water_bytes", "gauge", "Most of the JSON arena in use at once.");
+        writeValue(out, "discord_json_arena_high_water_bytes", registry.jsonArenaHighWater.value());
+        writeMetric(out, "discord_json_arena_failures_total", "counter", "JSON documents refused for lack of arena space.");
+        writeValue(out, "discord_json_arena_failures_total", registry.jsonArenaFailures.value());
+
+        writeHistogram(out, "discord_interaction_latency_ms",
+            "Interaction received to callback response completed.", registry.interactionLatency);
+        writeHistogram(out, "discord_interaction_transit_ms",
+            "Interaction created, by its snowflake, to received.", registry.interactionTransit);
+        writeHistogram(out, "discord_interaction_parse_ms", "Interaction received to parsed.", registry.interactionParse);
+        writeHistogram(out, "discord_interaction_handler_ms", "Interaction parsed to handler returned.",
+            registry.interactionHandler);
+        writeHistogram(out, "discord_interaction_post_ms", "Response queued to POST acknowledged.",
+            registry.interactionPost);
+        writeHistogram(out, "discord_interaction_wake_ms", "Interaction received to wake packet sent.",
+            registry.interactionWake);
+        writeHistogram(out, "discord_heartbeat_rtt_ms", "Gateway heartbeat round trip time.", registry.heartbeatRtt);
+
+        writeMetric(out, "discord_interaction_responses_shed_total", "counter", "Interactions answered with the busy message.");
+        writeValue(out, "discord_interaction_responses_shed_total", registry.responsesShed.value());
+
+        writeMetric(out, "discord_rest_responses_total", "counter", "REST responses by status class.");
+        out.print("discord_rest_responses_total{status=\"failed\"} ");
+        out.println(registry.restResponses[0].value());
+        for (size_t i = 1; i < Registry::REST_CLASSES; ++i) {
+            out.print("discord_rest_responses_total{status=\"");
+            out.print(i);
+            out.print("xx\"} ");
+            out.println(registry.restResponses[i].value());
+        }
+        writeMetric(out, "discord_rest_rate_limited_total", "counter", "REST responses with status 429.");
+        writeValue(out, "discord_rest_rate_limited_total", registry.restRateLimited.value());
+        writeMetric(out, "discord_rest_connections_total", "counter",
+            "REST requests by whether they reused a kept-alive connection or opened a new one.");
+        out.print("discord_rest_connections_total{connection=\"reused\"} ");
+        out.println(registry.restConnectionsReused.value());
+        out.print("discord_rest_connections_total{connection=\"opened\"} ");
+        out.println(registry.restConnectionsOpened.value());
+
+        writeMetric(out, "discord_gateway_connects_total", "counter", "Gateway WebSocket connections opened.");
+        writeValue(out, "discord_gateway_connects_total", registry.gatewayConnects.value());
+        writeMetric(out, "discord_gateway_disconnects_total", "counter", "Gateway WebSocket connections lost.");
+        writeValue(out, "discord_gateway_disconnects_total", registry.gatewayDisconnects.value());
+
+        writeMetric(out, "discord_gateway_heartbeat_timeouts_total", "counter", "Connections dropped for a missed heartbeat ACK.");
+        writeValue(out, "discord_gateway_heartbeat_timeouts_total", registry.heartbeatTimeouts.value());
+
+        writeMetric(out, "discord_gateway_opcodes_total", "counter", "Gateway payloads received by opcode.");
+        for (size_t i = 0; i < Registry::OPCODES; ++i) {
+            out.print("discord_gateway_opcodes_total{op=\"");
+            out.print(i);
+            out.print("\"} ");
+            out.println(registry.opcodes[i].value());
+        }
+        writeMetric(out, "discord_gateway_dispatches_total", "counter", "Dispatch events received by type.");
+        for (size_t i = 0; i < Registry::DISPATCH_COUNT; ++i) {
+            out.print("discord_gateway_dispatches_total{event=\"");
+            out.print(DISPATCH_NAMES[i]);
+            out.print("\"} ");
+            out.println(registry.dispatches[i].value());
+        }
+    }
+
+    void writeSummary(Print& out) {
+        out.print("Uptime: ");
+        out.print(millis() / 1000);
+        out.println("s");
+
+        out.print("Heap: ");
+        out.print(freeHeap());
+        out.print("b free, ");
+        out.print(largestFreeBlock());
+        out.print("b largest block, ");
+        out.print(minimumFreeHeap());
+        out.println("b lowest");
+
+        out.print("Stack high-water: loop ");
+        out.print(registry.loopStackHighWater.value());
+        out.print("b, post task ");
+        out.print(registry.postTaskStackHighWater.value());
+        out.println("b");
+
+        out.print("Stack used at most: post task ");
+        out.print(Stack::observed(Stack::Task::Post));
+        out.print("b, log task ");
+        out.print(Stack::observed(Stack::Task::Log));
+        out.println("b");
+
+        out.print("JSON arena high-water: ");
+        out.print(registry.jsonArenaHighWater.value());
+        out.print("b, ");
+        out.print(registry.jsonArenaFailures.value());
+        out.println(" refused");
+
+        writeLatencySummary(out, "Interactions", registry.interactionLatency);
+        writeLatencySummary(out, "- Transit", registry.interactionTransit);
+        writeLatencySummary(out, "- Parse", registry.interactionParse);
+        writeLatencySummary(out, "- Handler", registry.interactionHandler);
+        writeLatencySummary(out, "- POST", registry.interactionPost);
+        writeLatencySummary(out, "Interaction to wake", registry.interactionWake);
+        writeLatencySummary(out, "Heartbeat RTT", registry.heartbeatRtt);
+        out.print("Interactions shed: ");
+        out.println(registry.responsesShed.value());
+
+        out.print("REST: ");
+        for (size_t i = 2; i < Registry::REST_CLASSES; ++i) {
+            out.print(registry.restResponses[i].value());
+            out.print(" ");
+            out.print(i);
+            out.print("xx, ");
+        }
+        out.print(registry.restRateLimited.value());
+        out.print(" rate limited, ");
+        out.print(registry.restResponses[0].value());
+        out.print(" failed, ");
+        out.print(registry.restConnectionsOpened.value());
+        out.print(" handshakes, ");
+        out.print(registry.restConnectionsReused.value());
+        out.println(" reused");
+
+        out.print("Gateway: ");
+        out.print(registry.gatewayConnects.value());
+        out.print(" connects, ");
+        out.print(registry.gatewayDisconnects.value());
+        out.print(" disconnects, ");
+        out.print(registry.heartbeatTimeouts.value());
+        out.print(" zombied, ");
+        out.print(registry.opcodes[0].value());
+        out.print(" dispatches, ");
+        out.print(registry.opcodes[11].value());
+        out.println(" heartbeat ACKs");
+    }
+}
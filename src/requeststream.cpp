@@ -0,0 +1,74 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <requeststream.h>
+
+namespace Discord {
+    namespace {
+        // Discards output up to an offset, then keeps what fits in a buffer and discards the rest.
+        class Window : public Print {
+        public:
+            Window(char* buffer, size_t skip, size_t room) : _buffer { buffer }, _skip { skip }, _room { room } {}
+
+            size_t write(uint8_t c) override {
+                return write(&c, 1);
+            }
+
+            size_t write(const uint8_t* data, size_t size) override {
+                size_t skipped = size < _skip ? size : _skip;
+                _skip -= skipped;
+                size_t kept = size - skipped < _room - _written ? size - skipped : _room - _written;
+                memcpy(_buffer + _written, data + skipped, kept);
+                _written += kept;
+                // Everything is reported as written, or the serializer would stop.
+                return size;
+            }
+
+            size_t written() const { return _written; }
+
+        private:
+            char* _buffer;
+            size_t _skip;
+            size_t _room;
+            size_t _written = 0;
+        };
+    }
+
+    size_t RequestStream::copy(char* buffer, size_t offset, size_t length) const {
+        if (offset >= _length || length == 0) return 0;
+        Window window(buffer, offset, length);
+        serializeJson(_body, window);
+        return window.written();
+    }
+
+    int RequestStream::read() {
+        char c;
+        return readBytes(&c, 1) == 1 ? static_cast<uint8_t>(c) : -1;
+    }
+
+    int RequestStream::peek() {
+        char c;
+        return copy(&c, _offset, 1) == 1 ? static_cast<uint8_t>(c) : -1;
+    }
+
+    size_t RequestStream::readBytes(char* buffer, size_t length) {
+        size_t count = copy(buffer, _offset, length);
+        _offset += count;
+        return count;
+    }
+}
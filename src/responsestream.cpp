@@ -0,0 +1,210 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <log.h>
+#include <responsestream.h>
+
+namespace Discord {
+    const char* ResponseStream::HEADERS[] = { "Transfer-Encoding" };
+    const size_t ResponseStream::HEADER_COUNT = sizeof(HEADERS) / sizeof(HEADERS[0]);
+
+    ResponseStream::ResponseStream(HTTPClient& client) : _client { client }, _stream { client.getStreamPtr() } {
+        int size = client.getSize();
+        if (_stream == nullptr) {
+            _state = State::Failed;
+        }
+        else if (size >= 0) {
+            _remaining = size;
+            _state = size > 0 ? State::Sized : State::Done;
+        }
+        else if (!client.hasHeader("Transfer-Encoding") || client.header("Transfer-Encoding").equalsIgnoreCase("chunked")) {
+            // Without the header collected, a body of unknown length on a kept-alive connection can only be chunked.
+            _state = State::ChunkHeader;
+        }
+        else {
+            _state = State::UntilClose;
+        }
+        setTimeout(_stream ? _stream->getTimeout() : 0);
+    }
+
+    int ResponseStream::nextRaw() {
+        unsigned long start = millis();
+        do {
+            int c = _stream->read();
+            if (c >= 0) return c;
+            if (!_stream->connected() && _stream->available() <= 0) return -1;
+            delay(1);
+        } while (millis() - start < getTimeout());
+        return -1;
+    }
+
+    bool ResponseStream::skipLine() {
+        int c;
+        while ((c = nextRaw()) >= 0) {
+            if (c == '\n') return true;
+        }
+        return false;
+    }
+
+    bool ResponseStream::readChunkHeader() {
+        // Size in hex, then optional extensions, then CRLF.
+        size_t size = 0;
+        int digits = 0;
+        int c;
+        while ((c = nextRaw()) >= 0) {
+            if (c >= '0' && c <= '9') size = size * 16 + (c - '0');
+            else if (c >= 'a' && c <= 'f') size = size * 16 + (c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') size = size * 16 + (c - 'A' + 10);
+            else break;
+            ++digits;
+        }
+        if (digits == 0 || (c != '\n' && !skipLine())) return false;
+
+        if (size == 0) {
+            // Last chunk: skip any trailers up to the empty line that ends the body.
+            for (;;) {
+                c = nextRaw();
+                if (c == '\r') c = nextRaw();
+                if (c == '\n') break;
+                if (c < 0 || !skipLine()) return false;
+            }
+            _state = State::Done;
+            return true;
+        }
+
+        _remaining = size;
+        _state = State::ChunkData;
+        return true;
+    }
+
+    void ResponseStream::fail() {
+        DISCORD_LOGE("[DISCORD] Response body cut short after %u bytes.", static_cast<unsigned>(_consumed));
+        _state = State::Failed;
+        // Whatever is left on the connection can no longer be framed, so it cannot be reused.
+        if (_stream) {
+            _stream->stop();
+        }
+    }
+
+    int ResponseStream::read() {
+        if (_peeked >= 0) {
+            int c = _peeked;
+            _peeked = -1;
+            return c;
+        }
+
+        for (;;) {
+            switch (_state) {
+                case State::Sized:
+                case State::ChunkData: {
+                    int c = nextRaw();
+                    if (c < 0) {
+                        fail();
+                        return -1;
+                    }
+                    ++_consumed;
+                    if (--_remaining == 0) {
+                        if (_state == State::Sized) {
+                            _state = State::Done;
+                        }
+                        // Chunk data is followed by CRLF.
+                        else if (!skipLine()) {
+                            fail();
+                        }
+                        else {
+                            _state = State::ChunkHeader;
+                        }
+                    }
+                    return c;
+                }
+                case State::ChunkHeader:
+                    if (!readChunkHeader()) {
+                        fail();
+                        return -1;
+                    }
+                    break;
+                case State::UntilClose: {
+                    int c = nextRaw();
+                    if (c < 0) {
+                        _state = State::Done;
+                        return -1;
+                    }
+                    ++_consumed;
+                    return c;
+                }
+                default:
+                    return -1;
+            }
+        }
+    }
+
+    int ResponseStream::peek() {
+        if (_peeked < 0) {
+            _peeked = read();
+        }
+        return _peeked;
+    }
+
+    int ResponseStream::available() {
+        if (_peeked >= 0) return 1;
+        if (_state == State::Done || _state == State::Failed) return 0;
+        int buffered = _stream->available();
+        if (_state == State::Sized || _state == State::ChunkData) {
+            return buffered < static_cast<int>(_remaining) ? buffered : _remaining;
+        }
+        return buffered;
+    }
+
+    size_t ResponseStream::readBytes(char* buffer, size_t length) {
+        size_t count = 0;
+        if (length > 0 && _peeked >= 0) {
+            buffer[count++] = _peeked;
+            _peeked = -1;
+        }
+        while (count < length) {
+            if (_state == State::Sized || _state == State::ChunkData) {
+                // Copy runs of the body in one go instead of a byte at a time.
+                size_t wanted = length - count;
+                if (wanted > _remaining) wanted = _remaining;
+                int buffered = _stream->available();
+                if (buffered > 1) {
+                    size_t run = static_cast<size_t>(buffered) < wanted ? buffered : wanted;
+                    int got = _stream->read(reinterpret_cast<uint8_t*>(buffer + count), run - 1);
+                    if (got > 0) {
+                        count += got;
+                        _consumed += got;
+                        _remaining -= got;
+                    }
+                }
+            }
+            // The last byte of a run goes through read(), which moves on to the next chunk or ends the body.
+            int c = read();
+            if (c < 0) break;
+            buffer[count++] = c;
+        }
+        return count;
+    }
+
+    bool ResponseStream::drain() {
+        _peeked = -1;
+        while (_state != State::Done && _state != State::Failed) {
+            if (read() < 0 && _state != State::Done) break;
+        }
+        return _state == State::Done;
+    }
+}
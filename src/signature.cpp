@@ -0,0 +1,71 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sodium.h>
+
+#include <signature.h>
+
+static_assert(Discord::Signature::PUBLIC_KEY_SIZE == crypto_sign_PUBLICKEYBYTES, "Unexpected Ed25519 key size.");
+static_assert(Discord::Signature::SIGNATURE_SIZE == crypto_sign_BYTES, "Unexpected Ed25519 signature size.");
+
+namespace Discord::Signature {
+    namespace {
+        int nibble(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+
+        bool ready = false;
+    }
+
+    bool begin() {
+        // Returns 1 if it was already initialised.
+        ready = ready || sodium_init() >= 0;
+        return ready;
+    }
+
+    bool decodeHex(const char* hex, uint8_t* out, size_t size) {
+        if (hex == nullptr || strlen(hex) != 2 * size) return false;
+        for (size_t i = 0; i < size; ++i) {
+            int high = nibble(hex[2 * i]);
+            int low = nibble(hex[2 * i + 1]);
+            if (high < 0 || low < 0) return false;
+            out[i] = (high << 4) | low;
+        }
+        return true;
+    }
+
+    bool verify(const uint8_t* publicKey, const char* signature, const char* timestamp, const char* body, size_t length) {
+        if (!ready || timestamp == nullptr) return false;
+
+        uint8_t decoded[SIGNATURE_SIZE];
+        if (!decodeHex(signature, decoded, sizeof(decoded))) return false;
+
+        // The signed message is the timestamp and body back to back.
+        size_t timestampLength = strlen(timestamp);
+        uint8_t* message = static_cast<uint8_t*>(malloc(timestampLength + length));
+        if (message == nullptr) return false;
+        memcpy(message, timestamp, timestampLength);
+        memcpy(message + timestampLength, body, length);
+        bool valid = crypto_sign_verify_detached(decoded, message, timestampLength + length, publicKey) == 0;
+        free(message);
+        return valid;
+    }
+}
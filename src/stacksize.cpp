@@ -0,0 +1,166 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <atomic>
+#include <mutex>
+
+#ifdef ESP32
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#endif
+
+#include <log.h>
+#include <stacksize.h>
+
+namespace Discord::Stack {
+    namespace {
+        // Usage is kept in steps of this many bytes, which bounds how often NVS gets written.
+        const uint32_t GRANULARITY = 32;
+
+        std::atomic<uint32_t> used[TASK_COUNT];
+        // Whether a run that took the task's deepest path has been seen. Until then its usage is not trusted.
+        std::atomic<bool> complete[TASK_COUNT];
+        std::once_flag loaded;
+
+#ifdef ESP32
+        const char* const NAMESPACE = "discord-stack";
+        const char* const BUILD_KEY = "build";
+        const char* const COMPLETE_KEY = "complete";
+        const char* const KEYS[TASK_COUNT] = { "post", "log" };
+        const size_t BUILD_ID_SIZE = 8;
+
+        uint32_t saved[TASK_COUNT];
+        uint8_t savedComplete = 0;
+        // NVS holds usage from another build, to be cleared before anything new is written.
+        bool stale = false;
+
+        // Identifies the running firmware, so usage measured under another build is not trusted.
+        void buildId(uint8_t* id) {
+            memcpy(id, esp_ota_get_app_description()->app_elf_sha256, BUILD_ID_SIZE);
+        }
+
+        uint8_t completeMask() {
+            uint8_t mask = 0;
+            for (size_t i = 0; i < TASK_COUNT; ++i) {
+                if (complete[i].load(std::memory_order_relaxed)) mask |= 1 << i;
+            }
+            return mask;
+        }
+
+        void load() {
+            Preferences prefs;
+            // Fails on first boot, while the namespace does not exist yet.
+            if (!prefs.begin(NAMESPACE, true)) return;
+
+            uint8_t current[BUILD_ID_SIZE], stored[BUILD_ID_SIZE];
+            buildId(current);
+            if (prefs.getBytes(BUILD_KEY, stored, BUILD_ID_SIZE) == BUILD_ID_SIZE
+                && memcmp(current, stored, BUILD_ID_SIZE) == 0) {
+                savedComplete = prefs.getUChar(COMPLETE_KEY, 0);
+                for (size_t i = 0; i < TASK_COUNT; ++i) {
+                    saved[i] = prefs.getUInt(KEYS[i], 0);
+                    used[i].store(saved[i], std::memory_order_relaxed);
+                    complete[i].store(savedComplete & (1 << i), std::memory_order_relaxed);
+                }
+            }
+            else {
+                stale = true;
+                DISCORD_LOGI("[STACK] New firmware, stack sizes will be measured again.");
+            }
+            prefs.end();
+        }
+#else
+        // Nothing to persist to, usage is only kept for the run.
+        void load() {}
+#endif
+
+        void ensureLoaded() {
+            std::call_once(loaded, load);
+        }
+    }
+
+    uint32_t size(Task task, uint32_t fallback) {
+        uint32_t seen = observed(task);
+#if DISCORD_STACK_AUTOSIZE
+        // Runs that stopped short of the deepest path say nothing about what it needs, so the default stays.
+        if (seen > 0 && complete[static_cast<size_t>(task)].load(std::memory_order_relaxed)) {
+            uint32_t sized = seen + DISCORD_STACK_MARGIN;
+            if (sized < DISCORD_STACK_MIN) sized = DISCORD_STACK_MIN;
+            // A task can only be seen using what it was given, so each run grows a tight stack by the margin.
+            // Past twice the default something is wrong, and more stack would only hide it.
+            if (sized > 2 * fallback) sized = 2 * fallback;
+            return sized;
+        }
+#endif
+        return fallback;
+    }
+
+    void record(Task task, uint32_t allocated, uint32_t unused, bool deepest) {
+        if (unused > allocated) return;
+        ensureLoaded();
+        uint32_t bytes = (allocated - unused + GRANULARITY - 1) / GRANULARITY * GRANULARITY;
+        std::atomic<uint32_t>& max = used[static_cast<size_t>(task)];
+        uint32_t previous = max.load(std::memory_order_relaxed);
+        while (bytes > previous && !max.compare_exchange_weak(previous, bytes, std::memory_order_relaxed)) {}
+        if (deepest) {
+            complete[static_cast<size_t>(task)].store(true, std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t observed(Task task) {
+        ensureLoaded();
+        return used[static_cast<size_t>(task)].load(std::memory_order_relaxed);
+    }
+
+    void save() {
+#ifdef ESP32
+        ensureLoaded();
+        bool changed = completeMask() != savedComplete;
+        for (size_t i = 0; i < TASK_COUNT; ++i) {
+            changed = changed || used[i].load(std::memory_order_relaxed) > saved[i];
+        }
+        if (!changed) return;
+
+        Preferences prefs;
+        if (!prefs.begin(NAMESPACE, false)) {
+            DISCORD_LOGE("[STACK] Could not open NVS to save stack usage.");
+            return;
+        }
+        if (stale) {
+            prefs.clear();
+            stale = false;
+        }
+        uint8_t id[BUILD_ID_SIZE];
+        buildId(id);
+        prefs.putBytes(BUILD_KEY, id, BUILD_ID_SIZE);
+        for (size_t i = 0; i < TASK_COUNT; ++i) {
+            uint32_t bytes = used[i].load(std::memory_order_relaxed);
+            if (bytes > saved[i] && prefs.putUInt(KEYS[i], bytes) > 0) {
+                DISCORD_LOGD("[STACK] Task %s has used up to %u bytes of stack.", KEYS[i], static_cast<unsigned>(bytes));
+                saved[i] = bytes;
+            }
+        }
+        uint8_t mask = completeMask();
+        if (mask != savedComplete && prefs.putUChar(COMPLETE_KEY, mask) > 0) {
+            savedComplete = mask;
+        }
+        prefs.end();
+#endif
+    }
+}
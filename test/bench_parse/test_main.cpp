@@ -0,0 +1,388 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <string>
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <discord.h>
+#include <discordmock.h>
+#include <interactions.h>
+#include <log.h>
+#include <metrics.h>
+
+// Replays a corpus of gateway frames through the bot, and times building the request bodies it sends, reporting the
+// cost of each per frame: time, heap allocated and the document capacity the frame or body needs. Run with
+// pio test -e native-bench. Timings are from the host, so only compare them between runs on the same machine.
+// Allocations and capacities follow the ESP32's, apart from ArduinoJson's slots being twice as large on 64-bit hosts.
+
+using Discord::Mock::server;
+using Discord::Metrics::registry;
+
+namespace {
+    constexpr unsigned ITERATIONS = 2000;
+
+    // Counted while measuring, by the allocator wrappers below.
+    bool counting = false;
+    size_t allocated = 0;
+    size_t allocations = 0;
+
+    class Discard : public Print {
+    public:
+        size_t write(uint8_t) override { return 1; }
+        size_t write(const uint8_t*, size_t size) override { return size; }
+    };
+
+    Discard discard;
+    Discord::Bot bot(Discord::Mock::BOT_TOKEN, false);
+    // Whether the interaction handler answers, and what answering it cost.
+    bool answer = false;
+    std::chrono::steady_clock::duration answerTime;
+    unsigned interactions = 0;
+
+    std::string snowflake(uint64_t value) {
+        return "\"" + std::to_string(value) + "\"";
+    }
+
+    std::string user(uint64_t id, const char* name) {
+        return "{\"id\":" + snowflake(id) + ",\"username\":\"" + name + "\",\"global_name\":\"" + name +
+            "\",\"discriminator\":\"0\",\"avatar\":\"8342729096ea3675442027381ff50dfe\",\"public_flags\":0}";
+    }
+
+    // Frames end with their sequence number, appended on every replay so none is skipped as a duplicate.
+    std::string frame(int op, const char* name, const std::string& data) {
+        std::string frame = "{\"op\":" + std::to_string(op) + ",\"t\":";
+        frame += name ? std::string("\"") + name + "\"" : "null";
+        return frame + ",\"d\":" + data + ",\"s\":";
+    }
+
+    std::string hello() {
+        return frame(10, nullptr, "{\"heartbeat_interval\":41250,\"_trace\":[\"[\\\"gateway-prd-us-east1-b-0568\\\","
+            "{\\\"micros\\\":0.0}]\"]}");
+    }
+
+    std::string ready() {
+        std::string guilds;
+        for (unsigned i = 0; i < 10; ++i) {
+            if (i) guilds += ",";
+            guilds += "{\"id\":" + snowflake(Discord::Mock::GUILD_ID + i) + ",\"unavailable\":true}";
+        }
+        return frame(0, "READY", "{\"v\":10,\"user_settings\":{},\"user\":" +
+            user(Discord::Mock::APPLICATION_ID, "mock-bot") + ",\"guilds\":[" + guilds + "],\"session_type\":\"normal\""
+            ",\"session_id\":\"3fd4ec5b0a4d18c3a2bc7c9e2d6c0f55\",\"resume_gateway_url\":\"wss://" +
+            Discord::Mock::RESUME_HOST + "\",\"shard\":[0,1],\"application\":{\"id\":" +
+            snowflake(Discord::Mock::APPLICATION_ID) + ",\"flags\":565248},\"_trace\":[\"[\\\"gateway-prd-us-east1-b"
+            "-0568\\\",{\\\"micros\\\":93741}]\"],\"private_channels\":[],\"presences\":[],\"relationships\":[]}");
+    }
+
+    std::string interactionCreate() {
+        return frame(0, "INTERACTION_CREATE", Discord::Mock::interactionPayload(Discord::Mock::APPLICATION_ID + 200,
+            "aW50ZXJhY3Rpb246MTEwMDAwMDAwMDAwMDAwMjAwOm1vY2staW50ZXJhY3Rpb24tdG9rZW4tZm9yLWJlbmNobWFya2luZw",
+            2, "wake", Discord::Mock::OWNER_ID, "[{\"name\":\"target\",\"type\":3,\"value\":\"nas\"}]").c_str());
+    }
+
+    std::string messageCreate() {
+        return frame(0, "MESSAGE_CREATE", "{\"type\":0,\"tts\":false,\"timestamp\":\"2023-06-01T12:00:00.000000+00:00\""
+            ",\"pinned\":false,\"mentions\":[],\"mention_roles\":[],\"mention_everyone\":false,\"member\":{\"roles\":["
+            + snowflake(Discord::Mock::GUILD_ID + 50) + "],\"premium_since\":null,\"pending\":false,\"nick\":null"
+            ",\"mute\":false,\"joined_at\":\"2023-01-01T00:00:00.000000+00:00\",\"flags\":0,\"deaf\":false"
+            ",\"communication_disabled_until\":null,\"avatar\":null},\"id\":" +
+            snowflake(Discord::Mock::APPLICATION_ID + 300) + ",\"flags\":0,\"embeds\":[],\"edited_timestamp\":null"
+            ",\"content\":\"Is the NAS awake yet? The backup job starts at midnight.\",\"components\":[]"
+            ",\"channel_id\":" + snowflake(Discord::Mock::CHANNEL_ID) + ",\"author\":" +
+            user(Discord::Mock::OWNER_ID, "mock-user") + ",\"attachments\":[],\"guild_id\":" +
+            snowflake(Discord::Mock::GUILD_ID) + "}");
+    }
+
+    // A guild of a few hundred members, as sent for each guild after READY to bots with the GUILDS intent.
+    std::string guildCreate() {
+        std::string roles, channels, members;
+        for (unsigned i = 0; i < 20; ++i) {
+            if (i) roles += ",";
+            roles += "{\"id\":" + snowflake(Discord::Mock::GUILD_ID + 50 + i) + ",\"name\":\"role-" + std::to_string(i) +
+                "\",\"color\":3447003,\"hoist\":false,\"position\":" + std::to_string(i) + ",\"permissions\":"
+                "\"137411140509249\",\"managed\":false,\"mentionable\":false,\"flags\":0}";
+        }
+        for (unsigned i = 0; i < 40; ++i) {
+            if (i) channels += ",";
+            channels += "{\"id\":" + snowflake(Discord::Mock::CHANNEL_ID + i) + ",\"type\":0,\"name\":\"channel-" +
+                std::to_string(i) + "\",\"position\":" + std::to_string(i) + ",\"parent_id\":null,\"topic\":null"
+                ",\"nsfw\":false,\"rate_limit_per_user\":0,\"permission_overwrites\":[],\"last_message_id\":" +
+                snowflake(Discord::Mock::APPLICATION_ID + 1000 + i) + ",\"flags\":0}";
+        }
+        for (unsigned i = 0; i < 100; ++i) {
+            if (i) members += ",";
+            members += "{\"user\":" + user(Discord::Mock::OWNER_ID + 1000 + i, "member") + ",\"roles\":[" +
+                snowflake(Discord::Mock::GUILD_ID + 50 + i % 20) + "],\"joined_at\":\"2023-01-01T00:00:00.000000+00:00\""
+                ",\"deaf\":false,\"mute\":false,\"flags\":0,\"pending\":false}";
+        }
+        return frame(0, "GUILD_CREATE", "{\"id\":" + snowflake(Discord::Mock::GUILD_ID) + ",\"name\":\"Mock Guild\""
+            ",\"icon\":null,\"owner_id\":" + snowflake(Discord::Mock::OWNER_ID) + ",\"verification_level\":1"
+            ",\"default_message_notifications\":1,\"explicit_content_filter\":2,\"features\":[\"COMMUNITY\",\"NEWS\"]"
+            ",\"mfa_level\":0,\"premium_tier\":0,\"preferred_locale\":\"en-US\",\"nsfw_level\":0,\"large\":false"
+            ",\"member_count\":100,\"joined_at\":\"2023-01-01T00:00:00.000000+00:00\",\"unavailable\":false"
+            ",\"roles\":[" + roles + "],\"channels\":[" + channels + "],\"members\":[" + members + "],\"threads\":[]"
+            ",\"emojis\":[],\"stickers\":[],\"presences\":[],\"voice_states\":[],\"stage_instances\":[]"
+            ",\"guild_scheduled_events\":[]}");
+    }
+
+    // The capacity a frame needs when parsed in place, as the bot parses it, found by growing the document until it
+    // fits. Frames that need more than DISCORD_FRAME_DOCUMENT_SIZE are dropped by the bot.
+    size_t needed(const std::string& frame) {
+        for (size_t capacity = 256;; capacity *= 2) {
+            std::string copy = frame;
+            DynamicJsonDocument doc(capacity);
+            if (deserializeJson(doc, &copy[0], copy.size()) != DeserializationError::NoMemory) {
+                return doc.memoryUsage();
+            }
+        }
+    }
+
+    // Logs in afresh, so that the session's sequence numbers start over.
+    bool connect() {
+        if (bot.active()) {
+            bot.logout();
+        }
+        server().reset();
+        bot.login();
+        return Discord::Mock::runUntil([]() {
+            bot.update(millis());
+            Discord::Log::flush();
+        }, []() { return bot.state() == Discord::Bot::ConnectionState::Ready; });
+    }
+
+    uint32_t frames() {
+        uint32_t total = 0;
+        for (const Discord::Metrics::Counter& counter : registry.opcodes) {
+            total += counter.value();
+        }
+        return total;
+    }
+
+    void row(const char* name, size_t length, std::chrono::steady_clock::duration time, unsigned count,
+        size_t document, const char* note = "") {
+        printf("%-20s %8u %10llu %10u %8u %10u  %s\n", name, static_cast<unsigned>(length),
+            static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(time).count() / count),
+            static_cast<unsigned>(allocated / count), static_cast<unsigned>(allocations / count),
+            static_cast<unsigned>(document), note);
+    }
+
+    void start() {
+        allocated = 0;
+        allocations = 0;
+    }
+
+    struct Replay {
+        // Capacity the frame needs.
+        size_t document;
+        // Times the bot parsed it.
+        uint32_t parsed;
+    };
+
+    // Delivers the frame over the bot's gateway connection ITERATIONS times.
+    // The copy made of each frame, as the socket library receives it into a buffer of its own, is timed with it and
+    // is the first allocation counted, of the frame's length.
+    Replay replay(const char* name, const std::string& body) {
+        static unsigned sequence = 1;
+        std::chrono::steady_clock::duration time {};
+        start();
+        uint32_t parsedBefore = frames();
+        for (unsigned i = 0; i < ITERATIONS; ++i) {
+            String frame((body + std::to_string(++sequence) + "}").c_str());
+            auto begin = std::chrono::steady_clock::now();
+            counting = true;
+            server().deliver(frame);
+            counting = false;
+            time += std::chrono::steady_clock::now() - begin;
+            Discord::Log::flush();
+        }
+        Replay result { needed(body + "1}"), frames() - parsedBefore };
+        row(name, body.size(), time, ITERATIONS, result.document,
+            result.document <= DISCORD_FRAME_DOCUMENT_SIZE ? "" : "exceeds the frame document");
+        return result;
+    }
+}
+
+#ifdef __GLIBC__
+// Wraps glibc's allocator to count what is allocated while measuring. ArduinoJson, String and the std containers
+// all allocate through these.
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t count, size_t size);
+    void* __libc_realloc(void* pointer, size_t size);
+
+    void* malloc(size_t size) {
+        if (counting) {
+            allocated += size;
+            ++allocations;
+        }
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t count, size_t size) {
+        if (counting) {
+            allocated += count * size;
+            ++allocations;
+        }
+        return __libc_calloc(count, size);
+    }
+
+    void* realloc(void* pointer, size_t size) {
+        if (counting) {
+            allocated += size;
+            ++allocations;
+        }
+        return __libc_realloc(pointer, size);
+    }
+}
+#endif
+
+void setUp(void) {}
+
+void tearDown(void) {
+    Discord::Log::flush();
+}
+
+void test_hello(void) {
+    // Resumes again on each, as it would on a new connection. The mock leaves the resume unanswered.
+    server().config.ignoreClient = true;
+    Replay result = replay("Hello", hello());
+    server().config.ignoreClient = false;
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, result.parsed);
+}
+
+void test_ready(void) {
+    Replay result = replay("READY", ready());
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, result.parsed);
+}
+
+void test_interaction_create(void) {
+    unsigned before = interactions;
+    Replay result = replay("INTERACTION_CREATE", interactionCreate());
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, result.parsed);
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, interactions - before);
+}
+
+void test_message_create(void) {
+    Replay result = replay("MESSAGE_CREATE", messageCreate());
+    TEST_ASSERT_EQUAL_UINT32(ITERATIONS, result.parsed);
+}
+
+void test_guild_create(void) {
+    // Bots that ask for no intents are never sent one, those with GUILDS are sent one per guild on every connect.
+    // Reported whether or not it fits the frame document. The bot parses it only if it does.
+    Replay result = replay("GUILD_CREATE", guildCreate());
+    bool fits = result.document <= DISCORD_FRAME_DOCUMENT_SIZE;
+    TEST_ASSERT_EQUAL_UINT32(fits ? ITERATIONS : 0, result.parsed);
+    TEST_ASSERT_TRUE(bot.online());
+}
+
+void test_serialize_command(void) {
+    // A command with one string option.
+    Discord::Interactions::ApplicationCommand::Option target;
+    target.name = "target";
+    target.description = "The machine to wake, defaults to the main terminal.";
+    target.type = Discord::Interactions::ApplicationCommand::OptionType::STRING;
+    target.required = false;
+    target.choices = nullptr;
+    Discord::Interactions::ApplicationCommand command;
+    command.name = "wake";
+    command.type = Discord::Interactions::CommandType::CHAT_INPUT;
+    command.description = "Send a wake signal to the main terminal. Authorized users only.";
+    command.default_member_permissions = 2147483648;
+    command.options = &target;
+    command.optionsLength = 1;
+
+    char body[1024];
+    size_t length = 0;
+    size_t document = 0;
+    std::chrono::steady_clock::duration time {};
+    start();
+    for (unsigned i = 0; i < ITERATIONS; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        counting = true;
+        StaticJsonDocument<1024> doc;
+        TEST_ASSERT_TRUE(Discord::Interactions::serializeCommand(command, doc));
+        length = serializeJson(doc, body, sizeof(body));
+        counting = false;
+        time += std::chrono::steady_clock::now() - begin;
+        document = doc.memoryUsage();
+    }
+    row("serializeCommand", length, time, ITERATIONS, document);
+}
+
+void test_command_response(void) {
+    // Answered from the interaction handler, as the sketch does, for interactions arriving over the gateway. The time
+    // includes the POST of the callback to the mock, which runs in place off-device. The document reported is what the
+    // body POSTed needs, the same slots as the response document the bot builds for it.
+    // The replays above numbered their frames past the mock's own.
+    TEST_ASSERT_TRUE(connect());
+
+    size_t length = 0;
+    std::chrono::steady_clock::duration time {};
+    start();
+    answer = true;
+    for (unsigned i = 0; i < ITERATIONS; ++i) {
+        size_t before = server().callbacks.size();
+        server().interaction("ping");
+        bool answered = Discord::Mock::runUntil([]() {
+            bot.update(millis());
+            Discord::Log::flush();
+        }, [&]() { return server().callbacks.size() > before; }, 1000, 0);
+        TEST_ASSERT_TRUE(answered);
+        time += answerTime;
+        length = server().callbacks.back().body.length();
+    }
+    answer = false;
+    row("sendCommandResponse", length, time, ITERATIONS, needed(server().callbacks.back().body.c_str()));
+}
+
+int main(int argc, char** argv) {
+    bot.onInteraction([](const char*, const Discord::Bot::Interaction&) {
+        ++interactions;
+        if (!answer) return;
+        Discord::Bot::MessageResponse response;
+        response.content = "Pong!";
+        response.flags = Discord::Bot::MessageResponse::Flags::EPHEMERAL;
+        auto begin = std::chrono::steady_clock::now();
+        counting = true;
+        bot.sendCommandResponse(Discord::Bot::InteractionResponse::CHANNEL_MESSAGE_WITH_SOURCE, response);
+        counting = false;
+        answerTime = std::chrono::steady_clock::now() - begin;
+    });
+    bool ready = connect();
+    // Only the connection is logged; what the replays log would be timed with them.
+    Discord::Log::begin(discard);
+    if (!ready) {
+        printf("Could not connect to the mock gateway.\n");
+        return 1;
+    }
+
+    printf("%u iterations each, per frame:\n", ITERATIONS);
+    printf("%-20s %8s %10s %10s %8s %10s\n", "", "bytes", "ns", "allocated", "allocs", "document");
+    UNITY_BEGIN();
+    RUN_TEST(test_hello);
+    RUN_TEST(test_ready);
+    RUN_TEST(test_interaction_create);
+    RUN_TEST(test_message_create);
+    RUN_TEST(test_guild_create);
+    RUN_TEST(test_serialize_command);
+    RUN_TEST(test_command_response);
+    return UNITY_END();
+}
@@ -0,0 +1,121 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <ctime>
+#include <vector>
+
+#include <Arduino.h>
+#include <PacketCapture.h>
+#include <WebServer.h>
+#include <unity.h>
+
+#include <discord.h>
+#include <discordmock.h>
+#include <log.h>
+
+// Sends /wake over the mock gateway to the sketch in src/main.cpp thousands of times, capturing each wake packet,
+// and reports how long after the gateway sent INTERACTION_CREATE the packet went out and the callback POST completed.
+// Run with pio test -e native-bench -v.
+// Without tasks on the host, the response is sent in place before the packet, where the ESP32 hands it to a task.
+// The packet's time here includes the response's, so it is an upper bound for the device.
+void setup();
+void loop();
+extern Discord::Bot discord;
+
+using Discord::Mock::server;
+
+namespace {
+    constexpr unsigned INTERACTIONS = 5000;
+    const char* const OPTIONS = "[{\"name\":\"target\",\"type\":3,\"value\":\"nas\"}]";
+
+    class Discard : public Print {
+    public:
+        size_t write(uint8_t) override { return 1; }
+        size_t write(const uint8_t*, size_t size) override { return size; }
+    };
+
+    Discard discard;
+
+    void step() {
+        loop();
+        Discord::Log::flush();
+    }
+
+    uint64_t realtimeNs() {
+        timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+    }
+
+    void report(const char* name, std::vector<unsigned long>& us) {
+        std::sort(us.begin(), us.end());
+        printf("%-36s p50 %6luus  p99 %6luus  max %6luus\n", name, us[us.size() / 2], us[us.size() * 99 / 100],
+            us.back());
+    }
+}
+
+void setUp(void) {}
+
+void tearDown(void) {
+    Discord::Log::flush();
+}
+
+void test_interaction_to_wake(void) {
+    ArduinoNative::PacketCapture capture;
+    TEST_ASSERT_NOT_EQUAL(0, capture.port());
+    std::vector<unsigned long> packetUs, callbackUs;
+    packetUs.reserve(INTERACTIONS);
+    callbackUs.reserve(INTERACTIONS);
+
+    for (unsigned i = 0; i < INTERACTIONS; ++i) {
+        size_t answered = server().callbacks.size();
+        // Queued on the connection for the next loop(), which receives it.
+        uint64_t id = server().interaction("wake", Discord::Mock::OWNER_ID, OPTIONS);
+        uint64_t sentNs = realtimeNs();
+        unsigned long sentUs = micros();
+        // Without moving the clock on, so the times are real.
+        TEST_ASSERT_TRUE(Discord::Mock::runUntil(step, [&] { return server().callbacks.size() > answered; }, 1000, 0));
+        TEST_ASSERT_EQUAL_UINT64(id, server().callbacks.back().interactionId);
+
+        ArduinoNative::CapturedPacket packet = capture.receive();
+        TEST_ASSERT_EQUAL_size_t(102, packet.data.size());
+        packetUs.push_back((packet.receivedNs - sentNs) / 1000);
+        callbackUs.push_back(server().callbacks.back().completedUs - sentUs);
+    }
+
+    printf("%u wakes, each from the gateway sending INTERACTION_CREATE:\n", INTERACTIONS);
+    report("to the wake packet sent", packetUs);
+    report("to the callback POST completed", callbackUs);
+}
+
+int main(int argc, char** argv) {
+    WebServer::listenOn(0);
+    setup();
+    Discord::Log::begin(discard);
+    server().reset();
+    if (!Discord::Mock::runUntil(step, [] { return discord.state() == Discord::Bot::ConnectionState::Ready; })) {
+        printf("Could not connect to the mock gateway.\n");
+        return 1;
+    }
+
+    UNITY_BEGIN();
+    RUN_TEST(test_interaction_to_wake);
+    return UNITY_END();
+}
@@ -0,0 +1,197 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <Arduino.h>
+#include <WebServer.h>
+#include <unity.h>
+
+#include <discord.h>
+#include <discordmock.h>
+#include <log.h>
+#include <metrics.h>
+
+// The bot's REST connection, kept alive across interaction responses, against the mock REST API. Each connection the
+// mock opens stands for a TLS handshake on the device.
+void setup();
+void loop();
+extern Discord::Bot discord;
+
+using Discord::Mock::server;
+using Discord::Metrics::registry;
+
+namespace {
+    // Time a connection takes to open, enough to stand out from everything else a response does.
+    constexpr unsigned long HANDSHAKE_MS = 50;
+
+    void step() {
+        loop();
+        Discord::Log::flush();
+    }
+
+    bool ready() {
+        return discord.state() == Discord::Bot::ConnectionState::Ready;
+    }
+
+    bool runUntil(const std::function<bool()>& done, unsigned long timeout = 60000, unsigned long tick = 10) {
+        return Discord::Mock::runUntil(step, done, timeout, tick);
+    }
+
+    const Discord::Mock::Callback* callbackFor(uint64_t id) {
+        for (const Discord::Mock::Callback& callback : server().callbacks) {
+            if (callback.interactionId == id) return &callback;
+        }
+        return nullptr;
+    }
+
+    const Discord::Mock::Request* requestFor(uint64_t id) {
+        String path = String("/interactions/") + String(static_cast<unsigned long long>(id)) + "/";
+        for (const Discord::Mock::Request& request : server().requests) {
+            if (request.path.indexOf(path) >= 0) return &request;
+        }
+        return nullptr;
+    }
+
+    // Sends /ping and waits for its response, without moving the clock on, so the time taken is real.
+    // @return The interaction's id, 0 if it was not answered.
+    uint64_t ping(unsigned long* responseUs = nullptr) {
+        unsigned long start = micros();
+        uint64_t id = server().interaction("ping");
+        if (!runUntil([&] { return callbackFor(id) != nullptr; }, 1000, 0)) return 0;
+        if (responseUs) {
+            *responseUs = callbackFor(id)->completedUs - start;
+        }
+        return id;
+    }
+}
+
+void setUp(void) {
+    if (discord.active()) {
+        discord.logout();
+    }
+    server().reset();
+    ArduinoNative::advanceClock(DISCORD_IDENTIFY_INTERVAL);
+    TEST_ASSERT_TRUE(runUntil(ready));
+}
+
+void tearDown(void) {
+    Discord::Log::flush();
+}
+
+void test_responses_share_one_connection(void) {
+    // The first may still have to connect, depending on what the login left open.
+    TEST_ASSERT_NOT_EQUAL(0, ping());
+    unsigned int opened = server().connectionsOpened;
+    uint32_t reused = registry.restConnectionsReused.value();
+
+    for (int i = 0; i < 5; ++i) {
+        uint64_t id = ping();
+        TEST_ASSERT_NOT_EQUAL(0, id);
+        TEST_ASSERT_TRUE(requestFor(id)->reused);
+    }
+    TEST_ASSERT_EQUAL_UINT(opened, server().connectionsOpened);
+    TEST_ASSERT_EQUAL_UINT32(reused + 5, registry.restConnectionsReused.value());
+}
+
+void test_heartbeat_ack_keeps_the_connection_alive(void) {
+    TEST_ASSERT_NOT_EQUAL(0, ping());
+    unsigned int opened = server().connectionsOpened;
+    size_t sent = server().requests.size();
+
+    TEST_ASSERT_TRUE(runUntil([&] { return server().requests.size() > sent; }, 2 * server().config.heartbeatInterval));
+    const Discord::Mock::Request& keepAlive = server().requests.back();
+    TEST_ASSERT_EQUAL_STRING("GET", keepAlive.method.c_str());
+    TEST_ASSERT_TRUE(keepAlive.path.endsWith("/gateway"));
+    TEST_ASSERT_TRUE(keepAlive.reused);
+    TEST_ASSERT_EQUAL_UINT(opened, server().connectionsOpened);
+}
+
+void test_reconnects_once_the_server_closes(void) {
+    // Every response is the last the connection serves, as behind a load balancer recycling connections.
+    server().config.keepAliveRequests = 1;
+    TEST_ASSERT_NOT_EQUAL(0, ping());
+    unsigned int opened = server().connectionsOpened;
+    uint32_t openedMetric = registry.restConnectionsOpened.value();
+
+    for (int i = 0; i < 3; ++i) {
+        uint64_t id = ping();
+        TEST_ASSERT_NOT_EQUAL(0, id);
+        TEST_ASSERT_FALSE(requestFor(id)->reused);
+    }
+    TEST_ASSERT_EQUAL_UINT(opened + 3, server().connectionsOpened);
+    TEST_ASSERT_EQUAL_UINT32(openedMetric + 3, registry.restConnectionsOpened.value());
+}
+
+void test_reconnects_after_an_idle_timeout(void) {
+    server().config.idleTimeout = 5000;
+    TEST_ASSERT_NOT_EQUAL(0, ping());
+    unsigned int opened = server().connectionsOpened;
+
+    ArduinoNative::advanceClock(2 * server().config.idleTimeout);
+    uint64_t id = ping();
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    TEST_ASSERT_FALSE(requestFor(id)->reused);
+    TEST_ASSERT_EQUAL_UINT(opened + 1, server().connectionsOpened);
+}
+
+void test_recovers_from_a_dropped_connection(void) {
+    TEST_ASSERT_NOT_EQUAL(0, ping());
+    unsigned int opened = server().connectionsOpened;
+
+    // Lost along with its response, which is not retried.
+    server().dropNext(1);
+    uint64_t lost = server().interaction("ping");
+    runUntil([] { return false; }, 100);
+    TEST_ASSERT_NULL(callbackFor(lost));
+
+    uint64_t id = ping();
+    TEST_ASSERT_NOT_EQUAL(0, id);
+    TEST_ASSERT_FALSE(requestFor(id)->reused);
+    TEST_ASSERT_EQUAL_UINT(opened + 1, server().connectionsOpened);
+}
+
+void test_reused_connection_skips_the_handshake(void) {
+    TEST_ASSERT_NOT_EQUAL(0, ping());
+    server().config.handshakeLatency = HANDSHAKE_MS;
+
+    unsigned long reusedUs = 0;
+    TEST_ASSERT_NOT_EQUAL(0, ping(&reusedUs));
+    // Closed after the next response, so the one after it connects again.
+    server().config.keepAliveRequests = 1;
+    TEST_ASSERT_NOT_EQUAL(0, ping());
+    unsigned long reconnectUs = 0;
+    TEST_ASSERT_NOT_EQUAL(0, ping(&reconnectUs));
+
+    printf("Response on a kept-alive connection: %luus, on a new one: %luus\n", reusedUs, reconnectUs);
+    TEST_ASSERT_LESS_THAN(HANDSHAKE_MS * 1000, reusedUs);
+    TEST_ASSERT_GREATER_OR_EQUAL(HANDSHAKE_MS * 1000, reconnectUs);
+}
+
+int main(int argc, char** argv) {
+    WebServer::listenOn(0);
+    setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_responses_share_one_connection);
+    RUN_TEST(test_heartbeat_ack_keeps_the_connection_alive);
+    RUN_TEST(test_reconnects_once_the_server_closes);
+    RUN_TEST(test_reconnects_after_an_idle_timeout);
+    RUN_TEST(test_recovers_from_a_dropped_connection);
+    RUN_TEST(test_reused_connection_skips_the_handshake);
+    return UNITY_END();
+}
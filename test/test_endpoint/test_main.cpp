@@ -0,0 +1,155 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <Arduino.h>
+#include <LocalClient.h>
+#include <M5Atom.h>
+#include <WebServer.h>
+#include <unity.h>
+
+#include <discord.h>
+#include <discordmock.h>
+#include <log.h>
+#include <metrics.h>
+
+// The sketch in src/main.cpp with a public key set, so interactions are POSTed to /interactions instead of arriving
+// over the gateway. Requests are signed with the mock application's key and sent from this host.
+void setup();
+void loop();
+extern Discord::Bot discord;
+extern const char* publicKey;
+extern bool botEnabled;
+
+using Discord::Mock::server;
+
+namespace {
+    const char* const TIMESTAMP = "1685620800";
+
+    void step() {
+        loop();
+        Discord::Log::flush();
+    }
+
+    ArduinoNative::LocalResponse post(const String& body, const String& signature, const char* timestamp = TIMESTAMP) {
+        return ArduinoNative::request(WebServer::localPort(), "POST", "/interactions",
+            { { "X-Signature-Ed25519", signature }, { "X-Signature-Timestamp", timestamp } }, body, step);
+    }
+
+    ArduinoNative::LocalResponse post(const String& body) {
+        return post(body, Discord::Mock::sign(TIMESTAMP, body));
+    }
+
+    String command(const char* name, uint64_t userId = Discord::Mock::OWNER_ID, const char* options = "[]") {
+        return server().newInteraction(name, userId, options);
+    }
+}
+
+void setUp(void) {
+    server().reset();
+    botEnabled = true;
+}
+
+void tearDown(void) {
+    Discord::Log::flush();
+}
+
+void test_ping_answered_with_pong(void) {
+    ArduinoNative::LocalResponse response = post("{\"type\":1}");
+    TEST_ASSERT_EQUAL_INT(200, response.status);
+    TEST_ASSERT_EQUAL_STRING("{\"type\":1}", response.body.c_str());
+}
+
+void test_bad_signatures_refused(void) {
+    String body = command("ping");
+    String signature = Discord::Mock::sign(TIMESTAMP, body);
+
+    // Discord checks endpoints with requests like these, and stops using ones that accept them.
+    TEST_ASSERT_EQUAL_INT(401, post(body, signature, "1685620801").status);
+    String tampered = body;
+    tampered.replace("\"ping\"", "\"wake\"");
+    TEST_ASSERT_EQUAL_INT(401, post(tampered, signature).status);
+    String flipped = signature;
+    flipped.setCharAt(0, flipped[0] == '0' ? '1' : '0');
+    TEST_ASSERT_EQUAL_INT(401, post(body, flipped).status);
+    TEST_ASSERT_EQUAL_INT(401, ArduinoNative::request(WebServer::localPort(), "POST", "/interactions", {}, body, step).status);
+}
+
+void test_malformed_body_refused(void) {
+    TEST_ASSERT_EQUAL_INT(400, post("{\"type\":2,").status);
+}
+
+void test_command_answered_inline(void) {
+    uint32_t answered = Discord::Metrics::registry.interactionLatency.count();
+    ArduinoNative::LocalResponse response = post(command("ping"));
+    TEST_ASSERT_EQUAL_INT(200, response.status);
+    TEST_ASSERT_TRUE(response.body.indexOf("\"type\":4") >= 0);
+    TEST_ASSERT_TRUE(response.body.indexOf("Uplink online.") >= 0);
+    TEST_ASSERT_EQUAL_UINT32(answered + 1, Discord::Metrics::registry.interactionLatency.count());
+
+    // Neither the gateway nor a callback request is involved.
+    TEST_ASSERT_EQUAL_UINT(0, server().connects);
+    TEST_ASSERT_EQUAL_size_t(0, server().requests.size());
+    TEST_ASSERT_FALSE(discord.active());
+}
+
+void test_wake_refused_for_other_users(void) {
+    ArduinoNative::LocalResponse response = post(command("wake", 42));
+    TEST_ASSERT_EQUAL_INT(200, response.status);
+    TEST_ASSERT_TRUE(response.body.indexOf("Access denied.") >= 0);
+    TEST_ASSERT_TRUE(response.body.indexOf("\"flags\":64") >= 0);
+}
+
+void test_refused_while_the_bot_is_disabled(void) {
+    botEnabled = false;
+    TEST_ASSERT_EQUAL_INT(503, post(command("ping")).status);
+}
+
+void test_commands_registered_without_the_gateway(void) {
+    // Held for 2.5-5s, the button registers the commands. Without READY the application id is looked up first.
+    M5.Btn.press();
+    step();
+    ArduinoNative::advanceClock(3000);
+    step();
+    M5.Btn.release();
+    step();
+
+    TEST_ASSERT_EQUAL_size_t(3, server().commands.size());
+    TEST_ASSERT_FALSE(server().requests.empty());
+    TEST_ASSERT_EQUAL_STRING("GET", server().requests.front().method.c_str());
+    TEST_ASSERT_TRUE(server().requests.front().path.endsWith("/oauth2/applications/@me"));
+    TEST_ASSERT_EQUAL_UINT(0, server().connects);
+}
+
+int main(int argc, char** argv) {
+    publicKey = Discord::Mock::publicKey();
+    WebServer::listenOn(0);
+    setup();
+    // Starts the server.
+    step();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_ping_answered_with_pong);
+    RUN_TEST(test_bad_signatures_refused);
+    RUN_TEST(test_malformed_body_refused);
+    RUN_TEST(test_command_answered_inline);
+    RUN_TEST(test_wake_refused_for_other_users);
+    RUN_TEST(test_refused_while_the_bot_is_disabled);
+    RUN_TEST(test_commands_registered_without_the_gateway);
+    return UNITY_END();
+}
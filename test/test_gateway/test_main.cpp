@@ -0,0 +1,391 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <Arduino.h>
+#include <LocalClient.h>
+#include <WebServer.h>
+#include <unity.h>
+
+#include <discord.h>
+#include <discordmock.h>
+#include <log.h>
+
+// The sketch in src/main.cpp, run against the mock gateway and REST API.
+void setup();
+void loop();
+extern Discord::Bot discord;
+
+using Discord::Mock::server;
+
+namespace {
+    void step() {
+        loop();
+        Discord::Log::flush();
+    }
+
+    bool ready() {
+        return discord.state() == Discord::Bot::ConnectionState::Ready;
+    }
+
+    bool runUntil(const std::function<bool()>& done, unsigned long timeout = 60000) {
+        return Discord::Mock::runUntil(step, done, timeout);
+    }
+
+    size_t callbacksFor(uint64_t id) {
+        size_t count = 0;
+        for (const Discord::Mock::Callback& callback : server().callbacks) {
+            if (callback.interactionId == id) ++count;
+        }
+        return count;
+    }
+
+    // Observations of a histogram on /metrics, or -1 if it is missing.
+    int countOf(const String& metrics, const char* histogram) {
+        String name = String(histogram) + "_count ";
+        int at = metrics.indexOf(name);
+        return at < 0 ? -1 : atoi(metrics.c_str() + at + name.length());
+    }
+
+    // Shards of the same application, run in place of the sketch's bot.
+    Discord::Bot shard0(Discord::Mock::BOT_TOKEN, false);
+    Discord::Bot shard1(Discord::Mock::BOT_TOKEN, false);
+
+    bool runShardUntil(Discord::Bot& shard, const std::function<bool()>& done, unsigned long timeout = 60000) {
+        return Discord::Mock::runUntil([&] {
+            shard.update(millis());
+            Discord::Log::flush();
+        }, done, timeout);
+    }
+
+    bool shardReady(Discord::Bot& shard) {
+        return shard.state() == Discord::Bot::ConnectionState::Ready;
+    }
+
+    // Hands the mock gateway over from the sketch's bot to the shards.
+    void stopSketch() {
+        discord.logout();
+        server().reset();
+        ArduinoNative::advanceClock(DISCORD_IDENTIFY_INTERVAL);
+    }
+
+    const Discord::Mock::Callback* callbackFor(uint64_t id) {
+        for (const Discord::Mock::Callback& callback : server().callbacks) {
+            if (callback.interactionId == id) return &callback;
+        }
+        return nullptr;
+    }
+}
+
+void setUp(void) {
+    // Every test starts from a fresh session, which may identify again straight away.
+    if (discord.active()) {
+        discord.logout();
+    }
+    server().reset();
+    ArduinoNative::advanceClock(DISCORD_IDENTIFY_INTERVAL);
+    TEST_ASSERT_TRUE(runUntil(ready));
+}
+
+void tearDown(void) {
+    Discord::Log::flush();
+}
+
+void test_identifies_on_the_gateway_url(void) {
+    TEST_ASSERT_EQUAL_UINT(1, server().identifies);
+    TEST_ASSERT_EQUAL_STRING(Discord::Mock::GATEWAY_HOST, server().lastHost.c_str());
+}
+
+void test_identifies_without_intents(void) {
+    // The sketch only handles interactions, which need none.
+    TEST_ASSERT_TRUE(server().lastIdentify.indexOf("\"intents\":0") >= 0);
+}
+
+void test_command_answered_over_the_callback(void) {
+    uint64_t id = server().interaction("ping");
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(id) > 0; }));
+
+    const Discord::Mock::Callback* callback = callbackFor(id);
+    TEST_ASSERT_TRUE(callback->body.indexOf("\"type\":4") >= 0);
+    TEST_ASSERT_TRUE(callback->body.indexOf("Uplink online.") >= 0);
+}
+
+void test_wake_refused_for_other_users(void) {
+    uint64_t id = server().interaction("wake", 42);
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(id) > 0; }));
+    TEST_ASSERT_TRUE(callbackFor(id)->body.indexOf("Access denied.") >= 0);
+}
+
+void test_wake_autocompletes_target_names(void) {
+    uint64_t id = server().interaction("wake", Discord::Mock::OWNER_ID,
+        "[{\"name\":\"target\",\"type\":3,\"value\":\"N\",\"focused\":true}]", 4);
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(id) > 0; }));
+
+    const String& body = callbackFor(id)->body;
+    TEST_ASSERT_TRUE(body.indexOf("\"type\":8") >= 0);
+    TEST_ASSERT_TRUE(body.indexOf("\"nas\"") >= 0);
+    TEST_ASSERT_TRUE(body.indexOf("\"main\"") < 0);
+}
+
+void test_wake_refuses_unknown_targets(void) {
+    uint64_t id = server().interaction("wake", Discord::Mock::OWNER_ID,
+        "[{\"name\":\"target\",\"type\":3,\"value\":\"printer\"}]");
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(id) > 0; }));
+    TEST_ASSERT_TRUE(callbackFor(id)->body.indexOf("Unknown target.") >= 0);
+}
+
+void test_heartbeats_acknowledged(void) {
+    unsigned long start = millis();
+    TEST_ASSERT_TRUE(runUntil([] { return server().heartbeats >= 2; }, 2 * server().config.heartbeatInterval));
+    TEST_ASSERT_TRUE(millis() - start >= server().config.heartbeatInterval);
+    TEST_ASSERT_TRUE(ready());
+}
+
+void test_resumes_after_the_connection_drops(void) {
+    server().disconnect(4000);
+    TEST_ASSERT_TRUE(runUntil([] { return !ready(); }));
+    TEST_ASSERT_TRUE(runUntil(ready));
+
+    TEST_ASSERT_EQUAL_UINT(1, server().identifies);
+    TEST_ASSERT_EQUAL_UINT(1, server().resumes);
+    TEST_ASSERT_EQUAL_STRING(Discord::Mock::RESUME_HOST, server().lastHost.c_str());
+}
+
+void test_events_missed_while_down_replayed_on_resume(void) {
+    server().disconnect(4000);
+    TEST_ASSERT_TRUE(runUntil([] { return !ready(); }));
+    // Sent while the bot is away, so only the resume brings it.
+    uint64_t id = server().interaction("ping");
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(id) > 0; }));
+    TEST_ASSERT_EQUAL_UINT(1, server().resumes);
+    TEST_ASSERT_EQUAL_size_t(1, callbacksFor(id));
+}
+
+void test_reconnect_request_resumes(void) {
+    server().reconnect();
+    TEST_ASSERT_TRUE(runUntil([] { return server().resumes > 0 && ready(); }));
+    TEST_ASSERT_EQUAL_UINT(1, server().identifies);
+}
+
+void test_invalid_session_identifies_again(void) {
+    server().invalidSession(false);
+    TEST_ASSERT_TRUE(runUntil([] { return server().identifies > 1 && ready(); }));
+    TEST_ASSERT_EQUAL_UINT(0, server().resumes);
+}
+
+void test_fatal_close_identifies_again(void) {
+    // The session has timed out, so the resume the bot tries first is refused.
+    server().disconnect(4009);
+    TEST_ASSERT_TRUE(runUntil([] { return server().identifies > 1 && ready(); }));
+    TEST_ASSERT_EQUAL_UINT(1, server().resumes);
+}
+
+void test_zombied_connection_resumes(void) {
+    server().config.ackHeartbeats = false;
+    TEST_ASSERT_TRUE(runUntil([] { return server().resumes > 0; }, 4 * server().config.heartbeatInterval));
+    server().config.ackHeartbeats = true;
+    TEST_ASSERT_TRUE(runUntil(ready));
+    TEST_ASSERT_EQUAL_UINT(1, server().identifies);
+    TEST_ASSERT_EQUAL_STRING(Discord::Mock::RESUME_HOST, server().lastHost.c_str());
+}
+
+void test_reconnects_once_the_gateway_is_reachable(void) {
+    server().config.refuseConnections = true;
+    server().disconnect(1001);
+    TEST_ASSERT_TRUE(runUntil([] { return !ready(); }));
+    TEST_ASSERT_FALSE(runUntil(ready, 30000));
+
+    server().config.refuseConnections = false;
+    TEST_ASSERT_TRUE(runUntil(ready, DISCORD_RECONNECT_BACKOFF_MAX + DISCORD_CONNECT_TIMEOUT));
+}
+
+void test_replayed_dispatch_skipped(void) {
+    // READY was the session's first dispatch, so another numbered 1 has been seen before.
+    String data = server().newInteraction("ping");
+    uint64_t id = server().lastInteraction();
+    server().deliver(String("{\"op\":0,\"s\":1,\"t\":\"INTERACTION_CREATE\",\"d\":") + data + "}");
+    TEST_ASSERT_FALSE(runUntil([&] { return callbacksFor(id) > 0; }, 5000));
+}
+
+void test_stats_answered_to_owners_only(void) {
+    uint64_t owner = server().interaction("stats");
+    uint64_t other = server().interaction("stats", 42);
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(owner) > 0 && callbacksFor(other) > 0; }));
+    TEST_ASSERT_TRUE(callbackFor(owner)->body.indexOf("Uptime: ") >= 0);
+    TEST_ASSERT_TRUE(callbackFor(owner)->body.indexOf("\"flags\":64") >= 0);
+    TEST_ASSERT_TRUE(callbackFor(other)->body.indexOf("Access denied.") >= 0);
+}
+
+void test_metrics_served_over_http(void) {
+    uint64_t id = server().interaction("ping");
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(id) > 0; }));
+
+    ArduinoNative::LocalResponse response = ArduinoNative::request(WebServer::localPort(), "GET", "/metrics", {}, "", loop);
+    TEST_ASSERT_EQUAL_INT(200, response.status);
+    TEST_ASSERT_TRUE(response.body.indexOf("# TYPE discord_uptime_seconds gauge") >= 0);
+    // At least the ping above has been timed.
+    TEST_ASSERT_TRUE(countOf(response.body, "discord_interaction_latency_ms") > 0);
+}
+
+void test_interaction_spans_timed(void) {
+    uint64_t id = server().interaction("ping");
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(id) > 0; }));
+
+    ArduinoNative::LocalResponse response = ArduinoNative::request(WebServer::localPort(), "GET", "/metrics", {}, "", loop);
+    TEST_ASSERT_EQUAL_INT(200, response.status);
+    TEST_ASSERT_TRUE(countOf(response.body, "discord_interaction_parse_ms") > 0);
+    TEST_ASSERT_TRUE(countOf(response.body, "discord_interaction_handler_ms") > 0);
+    TEST_ASSERT_TRUE(countOf(response.body, "discord_interaction_post_ms") > 0);
+}
+
+void test_latency_does_not_lose_interactions(void) {
+    server().config.gatewayLatency = 50;
+    server().config.restLatency = 20;
+    uint64_t first = server().interaction("ping");
+    uint64_t second = server().interaction("stats");
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(first) > 0 && callbacksFor(second) > 0; }));
+    TEST_ASSERT_EQUAL_size_t(1, callbacksFor(first));
+    TEST_ASSERT_EQUAL_size_t(1, callbacksFor(second));
+}
+
+void test_flood_answered_busy(void) {
+    // Response tasks run alongside the loop, and each holds the REST client for the request's latency, so the
+    // interaction past DISCORD_RESPONSES_IN_FLIGHT_MAX arrives with all of them in flight.
+    server().config.restLatency = 200;
+    uint32_t shed = Discord::Metrics::registry.responsesShed.value();
+    uint64_t ids[DISCORD_RESPONSES_IN_FLIGHT_MAX + 1];
+    ArduinoNative::runTasksOnThreads(true);
+    for (uint64_t& id : ids) {
+        id = server().interaction("ping");
+        step();
+        // Lets the task take the REST client, as its higher priority would on the device.
+        delay(20);
+    }
+    // The busy reply is sent in place, so it is in by the time the shed is counted.
+    bool answered = runUntil([&] { return Discord::Metrics::registry.responsesShed.value() > shed; });
+    ArduinoNative::runTasksOnThreads(false);
+    TEST_ASSERT_TRUE(answered);
+
+    for (size_t i = 0; i < DISCORD_RESPONSES_IN_FLIGHT_MAX; ++i) {
+        TEST_ASSERT_EQUAL_size_t(1, callbacksFor(ids[i]));
+        TEST_ASSERT_TRUE(callbackFor(ids[i])->body.indexOf("Uplink online.") >= 0);
+    }
+    const Discord::Mock::Callback* busy = callbackFor(ids[DISCORD_RESPONSES_IN_FLIGHT_MAX]);
+    TEST_ASSERT_NOT_NULL(busy);
+    TEST_ASSERT_TRUE(busy->body.indexOf(DISCORD_BUSY_MESSAGE) >= 0);
+    TEST_ASSERT_EQUAL_UINT32(shed + 1, Discord::Metrics::registry.responsesShed.value());
+}
+
+void test_malformed_frame_ignored(void) {
+    server().deliver("{\"op\":0,\"s\":");
+    uint64_t id = server().interaction("ping");
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(id) > 0; }));
+    TEST_ASSERT_TRUE(ready());
+}
+
+void test_oversized_token_not_answered(void) {
+    // No callback URL can be built from a token that does not fit, so the interaction goes unanswered.
+    uint64_t id = Discord::Mock::APPLICATION_ID + 301;
+    String token;
+    while (token.length() <= Discord::InteractionToken::CAPACITY) token += "mock-interaction-token-";
+    server().dispatch("INTERACTION_CREATE",
+        Discord::Mock::interactionPayload(id, token.c_str(), 2, "ping", Discord::Mock::OWNER_ID, "[]"));
+    uint64_t next = server().interaction("ping");
+    TEST_ASSERT_TRUE(runUntil([&] { return callbacksFor(next) > 0; }));
+    TEST_ASSERT_EQUAL_UINT(0, callbacksFor(id));
+}
+
+void test_shards_identify_with_their_shard(void) {
+    stopSketch();
+    shard0.setShard(0, 2);
+    shard0.login(0);
+    TEST_ASSERT_TRUE(runShardUntil(shard0, [] { return shardReady(shard0); }));
+    TEST_ASSERT_TRUE(server().lastIdentify.indexOf("\"shard\":[0,2]") >= 0);
+    // Asked /gateway/bot, which needs the token.
+    TEST_ASSERT_EQUAL_STRING("/api/v10/gateway/bot", server().requests.front().path.c_str());
+    shard0.logout();
+
+    shard1.setShard(1, 2);
+    shard1.login(0);
+    TEST_ASSERT_TRUE(runShardUntil(shard1, [] { return shardReady(shard1); }));
+    TEST_ASSERT_TRUE(server().lastIdentify.indexOf("\"shard\":[1,2]") >= 0);
+    shard1.logout();
+}
+
+void test_shards_identify_an_interval_apart(void) {
+    // With max_concurrency 1, both shards are in the same identify bucket.
+    stopSketch();
+    shard0.setShard(0, 2);
+    shard0.login(0);
+    TEST_ASSERT_TRUE(runShardUntil(shard0, [] { return shardReady(shard0); }));
+    unsigned long first = server().lastIdentifyAt;
+    shard0.logout();
+
+    shard1.setShard(1, 2);
+    shard1.login(0);
+    // Connected, but holding its identify back.
+    TEST_ASSERT_FALSE(runShardUntil(shard1, [] { return server().identifies > 1; }, DISCORD_IDENTIFY_INTERVAL / 2));
+    TEST_ASSERT_TRUE(shard1.active());
+    TEST_ASSERT_TRUE(runShardUntil(shard1, [] { return shardReady(shard1); }));
+    TEST_ASSERT_EQUAL_UINT(2, server().identifies);
+    TEST_ASSERT_GREATER_OR_EQUAL(first + DISCORD_IDENTIFY_INTERVAL, server().lastIdentifyAt);
+    shard1.logout();
+}
+
+void test_shard_beyond_the_recommended_count_logs_out(void) {
+    // The mock recommends a single shard.
+    stopSketch();
+    shard1.setShard(1);
+    shard1.login(0);
+    TEST_ASSERT_TRUE(runShardUntil(shard1, [] { return !shard1.active(); }));
+    TEST_ASSERT_EQUAL_UINT(1, shard1.shardCount());
+    TEST_ASSERT_EQUAL_UINT(0, server().connects);
+    TEST_ASSERT_EQUAL_UINT(0, server().identifies);
+}
+
+int main(int argc, char** argv) {
+    WebServer::listenOn(0);
+    setup();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_identifies_on_the_gateway_url);
+    RUN_TEST(test_identifies_without_intents);
+    RUN_TEST(test_command_answered_over_the_callback);
+    RUN_TEST(test_wake_refused_for_other_users);
+    RUN_TEST(test_wake_autocompletes_target_names);
+    RUN_TEST(test_wake_refuses_unknown_targets);
+    RUN_TEST(test_heartbeats_acknowledged);
+    RUN_TEST(test_resumes_after_the_connection_drops);
+    RUN_TEST(test_events_missed_while_down_replayed_on_resume);
+    RUN_TEST(test_reconnect_request_resumes);
+    RUN_TEST(test_invalid_session_identifies_again);
+    RUN_TEST(test_fatal_close_identifies_again);
+    RUN_TEST(test_zombied_connection_resumes);
+    RUN_TEST(test_reconnects_once_the_gateway_is_reachable);
+    RUN_TEST(test_replayed_dispatch_skipped);
+    RUN_TEST(test_stats_answered_to_owners_only);
+    RUN_TEST(test_metrics_served_over_http);
+    RUN_TEST(test_interaction_spans_timed);
+    RUN_TEST(test_latency_does_not_lose_interactions);
+    RUN_TEST(test_flood_answered_busy);
+    RUN_TEST(test_malformed_frame_ignored);
+    RUN_TEST(test_oversized_token_not_answered);
+    RUN_TEST(test_shards_identify_with_their_shard);
+    RUN_TEST(test_shards_identify_an_interval_apart);
+    RUN_TEST(test_shard_beyond_the_recommended_count_logs_out);
+    return UNITY_END();
+}
@@ -0,0 +1,148 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <Arduino.h>
+#include <LocalClient.h>
+#include <PacketCapture.h>
+#include <WebServer.h>
+#include <WiFiUdp.h>
+#include <unity.h>
+
+#include <discordmock.h>
+#include <log.h>
+
+// The sketch in src/main.cpp with a LAN token set, so targets can be woken with a request to /wake from the LAN.
+// Wake packets are captured on a local socket instead of being broadcast.
+void setup();
+void loop();
+extern const char* lanToken;
+
+using Discord::Mock::server;
+
+namespace {
+    const char* const TOKEN = "lan-test-token";
+
+    void step() {
+        loop();
+        Discord::Log::flush();
+    }
+
+    ArduinoNative::LocalResponse wake(const char* query, const String& authorization = String("Bearer ") + TOKEN,
+        const char* method = "POST") {
+        std::vector<std::pair<String, String>> headers;
+        if (!authorization.isEmpty()) {
+            headers.push_back({ "Authorization", authorization });
+        }
+        return ArduinoNative::request(WebServer::localPort(), method, String("/wake") + query, headers, "", step);
+    }
+
+    // The magic packet for a MAC address: 6 bytes of 0xFF, then the address 16 times.
+    std::string magicPacket(const uint8_t (&mac)[6]) {
+        std::string packet(6, '\xff');
+        for (int i = 0; i < 16; ++i) {
+            packet.append(reinterpret_cast<const char*>(mac), sizeof(mac));
+        }
+        return packet;
+    }
+
+    const uint8_t MAIN_MAC[6] = { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x01 };
+    const uint8_t NAS_MAC[6] = { 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x02 };
+
+    ArduinoNative::PacketCapture* capture;
+}
+
+void setUp(void) {
+    server().reset();
+    capture = new ArduinoNative::PacketCapture();
+    TEST_ASSERT_NOT_EQUAL(0, capture->port());
+}
+
+void tearDown(void) {
+    delete capture;
+    Discord::Log::flush();
+}
+
+void test_wakes_the_named_target(void) {
+    ArduinoNative::LocalResponse response = wake("?target=nas");
+    TEST_ASSERT_EQUAL_INT(200, response.status);
+    TEST_ASSERT_EQUAL_STRING("Wake packet sent to nas.\n", response.body.c_str());
+
+    ArduinoNative::CapturedPacket packet = capture->receive();
+    TEST_ASSERT_EQUAL_size_t(102, packet.data.size());
+    TEST_ASSERT_TRUE(packet.data == magicPacket(NAS_MAC));
+    // Broadcast on the subnet, to the discard port.
+    TEST_ASSERT_EQUAL_STRING("192.168.1.255", WiFiUDP::lastDestination().toString().c_str());
+    TEST_ASSERT_EQUAL_UINT16(9, WiFiUDP::lastPort());
+}
+
+void test_wakes_the_first_target_by_default(void) {
+    TEST_ASSERT_EQUAL_INT(200, wake("").status);
+    TEST_ASSERT_TRUE(capture->receive().data == magicPacket(MAIN_MAC));
+}
+
+void test_target_names_ignore_case(void) {
+    TEST_ASSERT_EQUAL_INT(200, wake("?target=NAS").status);
+    TEST_ASSERT_TRUE(capture->receive().data == magicPacket(NAS_MAC));
+}
+
+void test_bad_tokens_refused(void) {
+    TEST_ASSERT_EQUAL_INT(401, wake("?target=nas", "").status);
+    TEST_ASSERT_EQUAL_INT(401, wake("?target=nas", "Bearer lan-test-tokem").status);
+    TEST_ASSERT_EQUAL_INT(401, wake("?target=nas", "Bearer lan-test-token2").status);
+    TEST_ASSERT_EQUAL_INT(401, wake("?target=nas", String("Basic ") + TOKEN).status);
+    TEST_ASSERT_TRUE(capture->receive(100).data.empty());
+}
+
+void test_unknown_target_refused(void) {
+    ArduinoNative::LocalResponse response = wake("?target=toaster");
+    TEST_ASSERT_EQUAL_INT(404, response.status);
+    TEST_ASSERT_EQUAL_STRING("Unknown target.\n", response.body.c_str());
+    TEST_ASSERT_TRUE(capture->receive(100).data.empty());
+}
+
+void test_only_posts_accepted(void) {
+    TEST_ASSERT_EQUAL_INT(404, wake("?target=nas", String("Bearer ") + TOKEN, "GET").status);
+    TEST_ASSERT_TRUE(capture->receive(100).data.empty());
+}
+
+void test_works_while_discord_is_unreachable(void) {
+    server().config.refuseConnections = true;
+    ArduinoNative::advanceClock(60000);
+    step();
+    TEST_ASSERT_EQUAL_INT(200, wake("?target=nas").status);
+    TEST_ASSERT_TRUE(capture->receive().data == magicPacket(NAS_MAC));
+}
+
+int main(int argc, char** argv) {
+    lanToken = TOKEN;
+    WebServer::listenOn(0);
+    setup();
+    // Starts the server.
+    step();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_wakes_the_named_target);
+    RUN_TEST(test_wakes_the_first_target_by_default);
+    RUN_TEST(test_target_names_ignore_case);
+    RUN_TEST(test_bad_tokens_refused);
+    RUN_TEST(test_unknown_target_refused);
+    RUN_TEST(test_only_posts_accepted);
+    RUN_TEST(test_works_while_discord_is_unreachable);
+    return UNITY_END();
+}
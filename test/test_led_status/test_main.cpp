@@ -0,0 +1,130 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+
+#include <Arduino.h>
+#include <unity.h>
+
+#include <ledstatus.h>
+
+// LedStatus stepped by hand, as the sketch does when no timer could be started. The clock is moved on past each
+// boundary by more than the test's own running time.
+
+namespace {
+    std::vector<uint32_t> writes;
+
+    void record(uint32_t colour) {
+        writes.push_back(colour);
+    }
+
+    constexpr uint32_t BLUE = 0x0000FF;
+    constexpr uint32_t GREEN = 0x00FF00;
+    constexpr uint32_t RED = 0xFF0000;
+}
+
+void setUp(void) {
+    writes.clear();
+}
+
+void tearDown(void) {}
+
+void test_highest_layer_shown(void) {
+    LedStatus led(record);
+    led.set(LedStatus::Layer::Connection, GREEN);
+    led.set(LedStatus::Layer::Error, RED);
+    led.set(LedStatus::Layer::Activity, BLUE);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(RED, writes.back());
+
+    led.clear(LedStatus::Layer::Error);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(BLUE, writes.back());
+    led.clear(LedStatus::Layer::Activity);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(GREEN, writes.back());
+}
+
+void test_written_only_on_change(void) {
+    LedStatus led(record);
+    led.set(LedStatus::Layer::Connection, GREEN);
+    for (int i = 0; i < 10; ++i) {
+        led.update();
+        // A standing request repeated from the loop.
+        led.set(LedStatus::Layer::Connection, GREEN);
+    }
+    TEST_ASSERT_EQUAL_UINT(1, writes.size());
+
+    // Covered by a request of the same colour above it.
+    led.set(LedStatus::Layer::Activity, GREEN, LedStatus::Mode::Solid, 100);
+    led.update();
+    TEST_ASSERT_EQUAL_UINT(1, writes.size());
+}
+
+void test_request_expires(void) {
+    LedStatus led(record);
+    led.set(LedStatus::Layer::Connection, GREEN);
+    led.set(LedStatus::Layer::Error, RED, LedStatus::Mode::Solid, 100);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(RED, writes.back());
+
+    ArduinoNative::advanceClock(50);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(RED, writes.back());
+    ArduinoNative::advanceClock(50);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(GREEN, writes.back());
+}
+
+void test_blink_steps_without_requests(void) {
+    LedStatus led(record);
+    led.set(LedStatus::Layer::Connection, BLUE, LedStatus::Mode::Blink);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(BLUE, writes.back());
+    ArduinoNative::advanceClock(LED_BLINK_PERIOD / 2);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(0, writes.back());
+    ArduinoNative::advanceClock(LED_BLINK_PERIOD / 2);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(BLUE, writes.back());
+    TEST_ASSERT_EQUAL_UINT(3, writes.size());
+}
+
+void test_fade_dims_and_returns(void) {
+    LedStatus led(record);
+    led.set(LedStatus::Layer::Connection, 0xFFFFFF, LedStatus::Mode::Fade);
+    led.update();
+    TEST_ASSERT_EQUAL_HEX32(0xFFFFFF, writes.back());
+    // Close to off half way through, allowing for the real time the test itself takes.
+    ArduinoNative::advanceClock(LED_FADE_PERIOD / 2);
+    led.update();
+    TEST_ASSERT_LESS_THAN(0x10, writes.back() & 0xFF);
+    ArduinoNative::advanceClock(LED_FADE_PERIOD / 4);
+    led.update();
+    TEST_ASSERT_TRUE(writes.back() > 0 && writes.back() < 0xFFFFFF);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_highest_layer_shown);
+    RUN_TEST(test_written_only_on_change);
+    RUN_TEST(test_request_expires);
+    RUN_TEST(test_blink_steps_without_requests);
+    RUN_TEST(test_fade_dims_and_returns);
+    return UNITY_END();
+}
@@ -0,0 +1,254 @@
+/*
+ * ESP32-Discord-WakeOnCommand v0.1
+ * Copyright (C) 2023  Neo Ting Wei Terrence
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <deque>
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <unity.h>
+
+#include <log.h>
+#include <responsestream.h>
+
+// ResponseStream reading bodies framed by Content-Length, by chunks and by the connection closing, from responses
+// handed to the client whole or cut short.
+
+namespace {
+    // Answers each request with the next of a list of raw responses, status line and headers included.
+    class CannedHost : public ArduinoNative::HttpHost {
+    public:
+        std::deque<String> responses;
+        unsigned int opened = 0;
+
+        uint32_t open(const String&, uint16_t) override { return ++opened; }
+        bool alive(uint32_t) override { return true; }
+        void close(uint32_t) override {}
+        bool handle(uint32_t, const ArduinoNative::HttpRequest&, String& response) override {
+            if (responses.empty()) return false;
+            response = responses.front();
+            responses.pop_front();
+            return true;
+        }
+    };
+
+    CannedHost host;
+    HTTPClient client;
+
+    const char* const BODY = "{\"id\":\"1100000000000000001\",\"name\":\"ping\",\"description\":\"Ping the bot.\"}";
+
+    String chunked(const String& chunks) {
+        return String("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n") + chunks;
+    }
+
+    String sized(const String& body, size_t length) {
+        return String("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: ") +
+            String(static_cast<unsigned>(length)) + "\r\n\r\n" + body;
+    }
+
+    // BODY in chunks of the given sizes, in hex, the last taking what is left.
+    String inChunks(std::initializer_list<size_t> sizes, const char* extension = "") {
+        String body(BODY);
+        String chunks;
+        size_t at = 0;
+        for (size_t size : sizes) {
+            if (at + size > body.length()) size = body.length() - at;
+            chunks += String(static_cast<unsigned>(size), 16) + extension + "\r\n" + body.substring(at, at + size) + "\r\n";
+            at += size;
+        }
+        if (at < body.length()) {
+            chunks += String(static_cast<unsigned>(body.length() - at), 16) + extension + "\r\n" + body.substring(at) + "\r\n";
+        }
+        return chunks;
+    }
+
+    bool get() {
+        client.begin("https://discord.com/api/v10/applications/1/commands");
+        client.collectHeaders(Discord::ResponseStream::HEADERS, Discord::ResponseStream::HEADER_COUNT);
+        return client.GET() == 200;
+    }
+
+    // Reads the body in reads of at most step bytes, as a deserializer pulling from the stream does.
+    String readAll(Discord::ResponseStream& stream, size_t step) {
+        String body;
+        char buffer[128];
+        for (;;) {
+            size_t read = stream.readBytes(buffer, step);
+            body.concat(buffer, read);
+            if (read < step) return body;
+        }
+    }
+}
+
+void setUp(void) {
+    ArduinoNative::setHttpHost(&host);
+    host.responses.clear();
+    host.opened = 0;
+    client.end();
+    client.setTimeout(100);
+}
+
+void tearDown(void) {
+    Discord::Log::flush();
+}
+
+void test_sized_body_read_in_any_step(void) {
+    for (size_t step : { 1, 2, 3, 7, 16, 64, 128 }) {
+        host.responses.push_back(sized(BODY, strlen(BODY)));
+        TEST_ASSERT_TRUE(get());
+        Discord::ResponseStream stream(client);
+        TEST_ASSERT_EQUAL_STRING(BODY, readAll(stream, step).c_str());
+        TEST_ASSERT_TRUE(stream.finished());
+        TEST_ASSERT_EQUAL_UINT(strlen(BODY), stream.consumed());
+    }
+}
+
+void test_chunked_body_read_in_any_step(void) {
+    // Single-byte chunks, where no run is copied in one go, next to ones longer than any step.
+    String chunks = inChunks({ 1, 1, 2, 3, 5, 8, 13, 21 }) + "0\r\n\r\n";
+    for (size_t step : { 1, 2, 3, 7, 16, 64, 128 }) {
+        host.responses.push_back(chunked(chunks));
+        TEST_ASSERT_TRUE(get());
+        Discord::ResponseStream stream(client);
+        TEST_ASSERT_EQUAL_STRING(BODY, readAll(stream, step).c_str());
+        TEST_ASSERT_TRUE(stream.finished());
+        TEST_ASSERT_EQUAL_UINT(strlen(BODY), stream.consumed());
+    }
+}
+
+void test_uppercase_chunk_sizes(void) {
+    String body(BODY);
+    host.responses.push_back(chunked("1A\r\n" + body.substring(0, 26) + "\r\n" + String(static_cast<unsigned>(body.length() - 26), 16) +
+        "\r\n" + body.substring(26) + "\r\n0\r\n\r\n"));
+    TEST_ASSERT_TRUE(get());
+    Discord::ResponseStream stream(client);
+    TEST_ASSERT_EQUAL_STRING(BODY, readAll(stream, 64).c_str());
+    TEST_ASSERT_TRUE(stream.finished());
+}
+
+void test_chunk_extensions_and_trailers_skipped(void) {
+    host.responses.push_back(chunked(inChunks({ 10, 30 }, ";name=value;flag") +
+        "0;last\r\nX-Checksum: 8f14e45f\r\nX-Served-By: cache\r\n\r\n"));
+    host.responses.push_back(sized("{}", 2));
+    TEST_ASSERT_TRUE(get());
+    {
+        Discord::ResponseStream stream(client);
+        TEST_ASSERT_EQUAL_STRING(BODY, readAll(stream, 16).c_str());
+        TEST_ASSERT_TRUE(stream.finished());
+    }
+
+    // Nothing of the trailers is left on the connection for the next response to trip over.
+    TEST_ASSERT_EQUAL_INT(0, client.getStream().available());
+    TEST_ASSERT_TRUE(get());
+    TEST_ASSERT_EQUAL_UINT(1, host.opened);
+    Discord::ResponseStream next(client);
+    TEST_ASSERT_EQUAL_STRING("{}", readAll(next, 16).c_str());
+}
+
+void test_peeked_byte_read_first(void) {
+    host.responses.push_back(chunked(inChunks({ 4 }) + "0\r\n\r\n"));
+    TEST_ASSERT_TRUE(get());
+    Discord::ResponseStream stream(client);
+    TEST_ASSERT_EQUAL_INT('{', stream.peek());
+    TEST_ASSERT_EQUAL_STRING(BODY, readAll(stream, 5).c_str());
+    TEST_ASSERT_TRUE(stream.finished());
+}
+
+void test_drain_leaves_the_connection_reusable(void) {
+    host.responses.push_back(chunked(inChunks({ 7, 7 }) + "0\r\nX-Checksum: 8f14e45f\r\n\r\n"));
+    host.responses.push_back(sized("{}", 2));
+    TEST_ASSERT_TRUE(get());
+    {
+        Discord::ResponseStream stream(client);
+        char buffer[10];
+        TEST_ASSERT_EQUAL_UINT(sizeof(buffer), stream.readBytes(buffer, sizeof(buffer)));
+        TEST_ASSERT_TRUE(stream.drain());
+        TEST_ASSERT_EQUAL_UINT(strlen(BODY), stream.consumed());
+    }
+    TEST_ASSERT_TRUE(client.connected());
+    TEST_ASSERT_TRUE(get());
+    Discord::ResponseStream next(client);
+    TEST_ASSERT_EQUAL_STRING("{}", readAll(next, 16).c_str());
+}
+
+void test_truncated_sized_body_fails(void) {
+    // The server closes after part of what it announced.
+    String partial = String(BODY).substring(0, 20);
+    host.responses.push_back(String("HTTP/1.1 200 OK\r\nContent-Length: ") + String(static_cast<unsigned>(strlen(BODY))) +
+        "\r\nConnection: close\r\n\r\n" + partial);
+    TEST_ASSERT_TRUE(get());
+    Discord::ResponseStream stream(client);
+    TEST_ASSERT_EQUAL_STRING(partial.c_str(), readAll(stream, 64).c_str());
+    TEST_ASSERT_FALSE(stream.finished());
+    TEST_ASSERT_FALSE(stream.drain());
+    TEST_ASSERT_FALSE(client.connected());
+}
+
+void test_truncated_chunk_fails(void) {
+    String body(BODY);
+    host.responses.push_back(String("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n") +
+        "10\r\n" + body.substring(0, 16) + "\r\n20\r\n" + body.substring(16, 24));
+    TEST_ASSERT_TRUE(get());
+    Discord::ResponseStream stream(client);
+    TEST_ASSERT_EQUAL_STRING(body.substring(0, 24).c_str(), readAll(stream, 7).c_str());
+    TEST_ASSERT_FALSE(stream.finished());
+    TEST_ASSERT_FALSE(client.connected());
+}
+
+void test_body_without_last_chunk_fails(void) {
+    host.responses.push_back(String("HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nConnection: close\r\n\r\n") +
+        inChunks({ 64 }));
+    TEST_ASSERT_TRUE(get());
+    Discord::ResponseStream stream(client);
+    TEST_ASSERT_EQUAL_STRING(BODY, readAll(stream, 128).c_str());
+    TEST_ASSERT_FALSE(stream.finished());
+    TEST_ASSERT_FALSE(stream.drain());
+}
+
+void test_malformed_chunk_size_fails(void) {
+    host.responses.push_back(chunked("zz\r\n{}\r\n0\r\n\r\n"));
+    TEST_ASSERT_TRUE(get());
+    Discord::ResponseStream stream(client);
+    char buffer[8];
+    TEST_ASSERT_EQUAL_UINT(0, stream.readBytes(buffer, sizeof(buffer)));
+    TEST_ASSERT_FALSE(stream.finished());
+    TEST_ASSERT_FALSE(client.connected());
+}
+
+void test_body_until_close(void) {
+    host.responses.push_back(String("HTTP/1.1 200 OK\r\nTransfer-Encoding: identity\r\nConnection: close\r\n\r\n") + BODY);
+    TEST_ASSERT_TRUE(get());
+    Discord::ResponseStream stream(client);
+    TEST_ASSERT_EQUAL_STRING(BODY, readAll(stream, 16).c_str());
+    TEST_ASSERT_TRUE(stream.finished());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sized_body_read_in_any_step);
+    RUN_TEST(test_chunked_body_read_in_any_step);
+    RUN_TEST(test_uppercase_chunk_sizes);
+    RUN_TEST(test_chunk_extensions_and_trailers_skipped);
+    RUN_TEST(test_peeked_byte_read_first);
+    RUN_TEST(test_drain_leaves_the_connection_reusable);
+    RUN_TEST(test_truncated_sized_body_fails);
+    RUN_TEST(test_truncated_chunk_fails);
+    RUN_TEST(test_body_without_last_chunk_fails);
+    RUN_TEST(test_malformed_chunk_size_fails);
+    RUN_TEST(test_body_until_close);
+    return UNITY_END();
+}